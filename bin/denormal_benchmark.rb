@@ -0,0 +1,67 @@
+#!/usr/bin/env ruby
+# Measures the CPU time taken by recursive filters while their state decays
+# after an impulse followed by silence.  Without flushing, the state decays
+# into tiny Floats that Ruby has to allocate on the heap, and then into
+# subnormal Floats, so processing silence gets slower over time.  With the
+# state flushed to zero below MB::Sound::Filter::DENORMAL_THRESHOLD, the time
+# per second of audio should stay flat.
+#
+# Pass --no-flush to disable flushing for comparison.  Buffers shorter than
+# MB::Sound::Filter::Biquad::VECTOR_MIN use the sample-by-sample kernels;
+# larger buffers use the block-based Biquad#process_vector.
+#
+# Example:
+#     bin/denormal_benchmark.rb 10 32
+#     bin/denormal_benchmark.rb --no-flush 10 32
+
+require 'bundler/setup'
+
+require 'benchmark'
+require 'pry-byebug'
+
+$LOAD_PATH << File.expand_path('../lib', __dir__)
+
+require 'mb-sound'
+
+USAGE = "\n\n#{MB::U.read_header_comment.join}\n(usage: #{$0} [--no-flush] [seconds [buffer_size]])"
+RATE = 48000
+
+if ARGV.delete('--no-flush')
+  # Nothing is smaller than zero in magnitude, so nothing is flushed
+  MB::Sound::Filter.send(:remove_const, :DENORMAL_THRESHOLD)
+  MB::Sound::Filter.const_set(:DENORMAL_THRESHOLD, 0.0)
+end
+
+seconds = Integer(ARGV[0] || 10) rescue 0
+raise "Invalid number of seconds given (must be >= 1) #{USAGE}" unless seconds >= 1
+
+buffer_size = Integer(ARGV[1] || 32) rescue 0
+raise "Invalid buffer size given (must be >= 1) #{USAGE}" unless buffer_size >= 1
+
+filters = {
+  'Biquad lowpass 20Hz' => MB::Sound::Filter::Cookbook.new(:lowpass, RATE, 20, quality: 0.7071),
+  'FirstOrder lowpass1p 50Hz' => MB::Sound::Filter::FirstOrder.new(:lowpass1p, RATE, 50),
+  'SimpleEnvelopeFollower' => MB::Sound::Filter::SimpleEnvelopeFollower.new(rate: RATE, decay_db: -1000, decay_s: 1),
+  'LinearFollower' => MB::Sound::Filter::LinearFollower.new(rate: RATE, max_rise: nil, max_fall: 10),
+}
+
+buffers = RATE / buffer_size
+silence = Numo::SFloat.zeros(buffer_size)
+impulse = silence.dup
+impulse[0] = 1
+
+name_width = filters.keys.map(&:length).max
+
+puts "Milliseconds to process each second of decaying silence (#{buffer_size} sample buffers):"
+puts
+
+filters.each do |name, filter|
+  filter.reset(0)
+  filter.process(impulse)
+
+  times = seconds.times.map {
+    Benchmark.realtime { buffers.times { filter.process(silence) } } * 1000
+  }
+
+  puts "#{name.ljust(name_width)}  #{times.map { |t| '%6.1f' % t }.join(' ')}  (max/min #{'%.2f' % (times.max / times.min)})"
+end
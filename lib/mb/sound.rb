@@ -17,6 +17,7 @@ require_relative 'sound/playback_methods'
 require_relative 'sound/fft_methods'
 require_relative 'sound/gain_methods'
 require_relative 'sound/window_methods'
+require_relative 'sound/correlation_methods'
 
 module MB
   # Convenience functions for making quick work of sound.
@@ -33,10 +34,16 @@ module MB
     extend FFTMethods
     extend GainMethods
     extend WindowMethods
+    extend CorrelationMethods
 
     # Filters a sound with the given filter parameters (see
     # MB::Sound::Filter::Cookbook).
     #
+    # If an +:output+ filename or stream is given, the +sound+ may be a
+    # filename or input stream, and is filtered in blocks of +:buffer_size+
+    # frames and written to the +:output+ (see #filter_stream) instead of
+    # being read into memory.  Returns the number of frames written.
+    #
     # +:frequency+ - The center or cutoff frequency of the filter.
     # +:filter_type+ - One of the filter types from MB::Sound::Filter::Cookbook::FILTER_TYPES.
     # +:rate+ - The sample rate to use for the filter (defaults to sound.rate if sound responds to :rate, or 48000).
@@ -45,26 +52,94 @@ module MB
     # +:slope+ - The slope for a shelf filter.  Specify one of quality, slope, or bandwidth.
     # +:bandwidth+ - The bandwidth of a peaking filter.
     # +:gain+ - The gain of a shelf or peaking filter.
-    def self.filter(sound, frequency:, filter_type: :lowpass, rate: nil, quality: nil, slope: nil, bandwidth: nil, gain: nil)
+    # +:output+ - An output filename or stream for streaming mode.
+    # +:buffer_size+ - The number of frames per block in streaming mode.
+    def self.filter(sound, frequency:, filter_type: :lowpass, rate: nil, quality: nil, slope: nil, bandwidth: nil, gain: nil, output: nil, buffer_size: 4096)
       # TODO: Further develop filters and sound sources into a sound
       # source/sink graph, where a complete graph can be built up with a DSL,
       # and actual generation only occurs on demand?
+      opened = sound = file_input(sound) if output && sound.is_a?(String)
+
       rate ||= sound.respond_to?(:rate) ? sound.rate : 48000
-      sound = any_sound_to_array(sound)
       frequency = frequency.frequency if frequency.respond_to?(:frequency) # get 343 from 343.hz
-      filter = MB::Sound::Filter::Cookbook.new(
-        filter_type,
-        rate,
-        frequency,
-        db_gain: gain&.to_db,
-        quality: quality,
-        bandwidth_oct: bandwidth,
-        shelf_slope: slope,
-      )
+      make_filter = -> {
+        MB::Sound::Filter::Cookbook.new(
+          filter_type,
+          rate,
+          frequency,
+          db_gain: gain&.to_db,
+          quality: quality,
+          bandwidth_oct: bandwidth,
+          shelf_slope: slope,
+        )
+      }
+
+      if output
+        return filter_stream(sound, output, sound.channels.times.map { make_filter.call }, rate: rate, buffer_size: buffer_size)
+      end
+
+      sound = any_sound_to_array(sound)
+      filter = make_filter.call
       sound.map { |c|
         filter.reset(c[0])
         filter.process(c)
       }
+    ensure
+      opened&.close
+    end
+
+    # Streams audio from +input+ (a filename or input stream) through
+    # +filters+ to +output+ (a filename or output stream), +:buffer_size+
+    # frames at a time, so arbitrarily long inputs use constant memory.
+    # Filter state carries over from one block to the next.  Streams opened
+    # from filenames are closed afterward.  Returns the number of frames
+    # written.
+    #
+    # The +filters+ may be an Array with one filter per channel (anything
+    # with a #process method that accepts a Numo::NArray), or a single
+    # multichannel processor whose #process method accepts and returns an
+    # Array of channels (e.g. ProcessingMatrix or FDNReverb).  Per-channel
+    # filters that support #reset are reset to the first sample of their
+    # channel.
+    #
+    # Example:
+    #     filters = 2.times.map { MB::Sound::Filter::Cookbook.new(:highpass, 48000, 80, quality: 0.7) }
+    #     MB::Sound.filter_stream('long_recording.flac', '/tmp/highpassed.flac', filters)
+    def self.filter_stream(input, output, filters, rate: nil, buffer_size: 4096)
+      opened_input = input = file_input(input) if input.is_a?(String)
+      opened_output = nil
+      rate ||= input.respond_to?(:rate) ? input.rate : 48000
+
+      if filters.is_a?(Array) && filters.length != input.channels
+        raise ArgumentError, "Got #{filters.length} filters for #{input.channels} channels"
+      end
+
+      frames = 0
+      first = true
+
+      loop do
+        data = input.read(buffer_size)
+        break if data.nil? || data[0].length == 0
+
+        if filters.is_a?(Array)
+          data = data.each_with_index.map { |c, idx|
+            filters[idx].reset(c[0]) if first && filters[idx].respond_to?(:reset)
+            filters[idx].process(c)
+          }
+        else
+          data = filters.process(data)
+        end
+        first = false
+
+        opened_output = output = file_output(output, rate: rate, channels: data.length) if output.is_a?(String)
+        output.write(data)
+        frames += data[0].length
+      end
+
+      frames
+    ensure
+      opened_input&.close
+      opened_output&.close
     end
 
     # Allows retrieving a Note by name using e.g. MB::Sound::A4 (or just A4 in
@@ -83,22 +158,45 @@ require_relative 'sound/io_input'
 require_relative 'sound/io_output'
 require_relative 'sound/ffmpeg_input'
 require_relative 'sound/ffmpeg_output'
+require_relative 'sound/multi_format_output'
 require_relative 'sound/alsa_input'
 require_relative 'sound/alsa_output'
 require_relative 'sound/jack_input'
 require_relative 'sound/jack_output'
+require_relative 'sound/jack_native'
 require_relative 'sound/null_input'
+require_relative 'sound/array_input'
 require_relative 'sound/null_output'
+require_relative 'sound/normalizing_output'
+require_relative 'sound/ring_buffer'
+require_relative 'sound/shared_ring'
+require_relative 'sound/shared_ring_input'
+require_relative 'sound/shared_ring_output'
+require_relative 'sound/virtual_device'
+require_relative 'sound/tee'
+require_relative 'sound/recorder'
 
 require_relative 'sound/oscillator'
+require_relative 'sound/tone_cache'
 require_relative 'sound/tone'
 require_relative 'sound/note'
 require_relative 'sound/plot_output'
 require_relative 'sound/filter'
 require_relative 'sound/noise'
+require_relative 'sound/exponential_sweep'
+require_relative 'sound/fdn_reverb'
+require_relative 'sound/noise_reduction'
+require_relative 'sound/additive_synth'
+require_relative 'sound/mapped_sample'
+require_relative 'sound/large_fft'
+require_relative 'sound/sampler'
+require_relative 'sound/granular_synth'
 require_relative 'sound/processing_matrix'
 require_relative 'sound/softest_clip'
+require_relative 'sound/dither'
 require_relative 'sound/complex_pan'
+require_relative 'sound/multichannel_pan'
+require_relative 'sound/binaural_renderer'
 require_relative 'sound/meter'
 
 require_relative 'sound/window'
@@ -0,0 +1,58 @@
+module MB
+  module Sound
+    # A process_stream-compatible input stream that reads from audio data
+    # already in memory (e.g. a Numo::NArray, or an Array of them with one per
+    # channel).  Useful for feeding stream-based code such as WindowReader
+    # from data returned by MB::Sound.read.
+    #
+    # Note: returned buffers are views into the original data, so do not
+    # modify them.
+    class ArrayInput
+      attr_reader :channels, :rate, :length, :frames_read, :buffer_size
+
+      # Initializes an input that returns the given +data+ and then ends.  The
+      # +data+ may be anything accepted by IOMethods#any_sound_to_array.
+      def initialize(data, rate: 48000, buffer_size: 800)
+        @data = MB::Sound.any_sound_to_array(data).map { |c| Numo::SFloat.cast(c) }
+        raise 'All channels must have the same length' if @data.map(&:length).uniq.length > 1
+
+        @channels = @data.length
+        @rate = rate
+        @length = @data[0].length
+        @buffer_size = buffer_size
+        @frames_read = 0
+        @closed = false
+      end
+
+      # Returns the number of frames that have not yet been read.
+      def remaining
+        @length - @frames_read
+      end
+
+      # Reads up to +frames+ frames, returning an Array of Numo::SFloat with
+      # one element per channel.  Returns empty arrays at the end of the data.
+      def read(frames)
+        raise 'This input is closed' if @closed
+        raise 'Must read at least one frame' if frames < 1
+
+        frames = remaining if frames > remaining
+        return [Numo::SFloat[]] * @channels if frames <= 0
+
+        start = @frames_read
+        @frames_read += frames
+
+        @data.map { |c| c[start...(start + frames)] }
+      end
+
+      # Closes the input, preventing future reading.
+      def close
+        @closed = true
+      end
+
+      # Returns true if this input has been closed.
+      def closed?
+        @closed
+      end
+    end
+  end
+end
@@ -0,0 +1,220 @@
+module MB
+  module Sound
+    # Renders any number of input channels to stereo headphone output by
+    # convolving each channel with the head-related impulse response (HRIR)
+    # of its direction, e.g. to monitor a surround mix on headphones.
+    #
+    # Convolution uses uniformly partitioned overlap-save: each HRIR is split
+    # into +:block_size+ partitions whose spectra are precomputed, each input
+    # block is transformed once and kept in a frequency-domain delay line
+    # shared by both ears, and every channel and partition is multiplied and
+    # summed in the frequency domain before a single inverse FFT per ear.
+    # Latency is one block, regardless of the HRIR length.
+    #
+    # Directions are azimuths in radians, counterclockwise from straight ahead
+    # (as in MultichannelPan), and each channel uses the HRIR nearest its
+    # direction.  When a channel's direction changes, the old and new HRIRs
+    # are crossfaded over one block.
+    #
+    # Example:
+    #     renderer = MB::Sound::BinauralRenderer.from_files(
+    #       {
+    #         30.degrees => 'hrir/azi_30.wav',
+    #         -30.degrees => 'hrir/azi_330.wav',
+    #         0 => 'hrir/azi_0.wav',
+    #         110.degrees => 'hrir/azi_110.wav',
+    #         -110.degrees => 'hrir/azi_250.wav',
+    #       },
+    #       directions: [30, -30, 0, 110, -110].map(&:degrees)
+    #     )
+    #     output.write(renderer.process(input.read(800)))
+    class BinauralRenderer
+      # The number of samples per partition and per FFT block.
+      attr_reader :block_size
+
+      # The number of partitions each HRIR is split into.
+      attr_reader :partitions
+
+      # The azimuths of the HRIRs in the set, in radians.
+      attr_reader :azimuths
+
+      # The current direction of each input channel, in radians.
+      attr_reader :directions
+
+      # The sample rate given to the constructor.
+      attr_reader :rate
+
+      # Loads an HRIR set from stereo (left, right) sound files, given as a
+      # Hash mapping azimuth in radians to filename, and returns a renderer.
+      # Files are read with MB::Sound.read, resampled to +:rate+.  Other
+      # keyword arguments are passed to #initialize.
+      def self.from_files(files, rate: 48000, **kwargs)
+        hrirs = files.map { |azimuth, filename|
+          data = MB::Sound.read(filename, rate: rate)
+          raise "#{filename} must have two channels (left and right)" unless data.length == 2
+          [azimuth, data]
+        }.to_h
+
+        new(hrirs, rate: rate, **kwargs)
+      end
+
+      # Initializes a renderer for the given HRIR set, a Hash mapping azimuth
+      # in radians to an Array of [left, right] impulse responses
+      # (Numo::NArrays).  The +:directions+ give each input channel's azimuth
+      # (see #directions=).
+      def initialize(hrirs, directions:, block_size: 256, rate: 48000)
+        raise 'At least one HRIR is required' if hrirs.nil? || hrirs.empty?
+        raise 'Block size must be an int >= 1' unless block_size.is_a?(Integer) && block_size >= 1
+
+        @block_size = block_size
+        @rate = rate
+        @bins = block_size + 1
+
+        @azimuths = hrirs.keys.map(&:to_f).freeze
+        length = hrirs.values.flatten.map(&:length).max
+        @partitions = [(length.to_f / block_size).ceil, 1].max
+
+        # Spectra of each zero-padded partition: [hrir, ear, partition, bin]
+        @spectra = Numo::DComplex.zeros(@azimuths.length, 2, @partitions, @bins)
+        hrirs.values.each_with_index do |(left, right), idx|
+          [left, right].each_with_index do |ir, ear|
+            padded = Numo::DFloat.zeros(@partitions, 2 * block_size)
+            ir = Numo::DFloat.cast(ir)
+            @partitions.times do |p|
+              part = ir[(p * block_size)...[(p + 1) * block_size, ir.length].min]
+              padded[p, 0...part.length] = part if part.length > 0
+            end
+            @spectra[idx, ear, true, true] = Numo::Pocketfft.rfft(padded)
+          end
+        end
+
+        @channels = directions.length
+        @hrir_index = Array.new(@channels)
+        @filters = Numo::DComplex.zeros(@channels, 2, @partitions, @bins)
+        @fdl = Numo::DComplex.zeros(@channels, @partitions, @bins)
+        @head = 0
+        @previous_input = Numo::DFloat.zeros(@channels, block_size)
+        @fade = Numo::DFloat.new(block_size).seq(0.5) / block_size
+
+        @input = RingBuffer.new(channels: @channels, capacity: block_size, type: Numo::DFloat)
+        @output = RingBuffer.new(channels: 2, capacity: 2 * block_size, type: Numo::DFloat)
+        @output.write([Numo::DFloat.zeros(block_size)] * 2)
+
+        @old_filters = nil
+        self.directions = directions
+      end
+
+      # The number of input channels.
+      def channels
+        @channels
+      end
+
+      # The processing latency in samples.
+      def latency
+        @block_size
+      end
+
+      # Changes the direction of each input channel to the given azimuths in
+      # radians.  The number of channels may not change.  Channels whose
+      # nearest HRIR changes are crossfaded to it over the next block.
+      def directions=(directions)
+        raise ArgumentError, "Expected #{@channels} directions, got #{directions.length}" unless directions.length == @channels
+
+        @directions = directions.map(&:to_f).freeze
+        directions.each_with_index do |azimuth, c|
+          idx = nearest(azimuth)
+          next if idx == @hrir_index[c]
+
+          if @hrir_index[c]
+            @old_filters ||= @filters.dup
+          end
+
+          @hrir_index[c] = idx
+          @filters[c, true, true, true] = @spectra[idx, true, true, true]
+        end
+      end
+
+      # Renders the given Array of input channels (Numo::NArrays of any
+      # length), returning [left, right] Numo::SFloats of the same length,
+      # delayed by #latency samples.
+      def process(data)
+        raise ArgumentError, "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+
+        length = data[0].length
+        out = [Numo::SFloat.zeros(length), Numo::SFloat.zeros(length)]
+        offset = 0
+
+        while offset < length
+          count = [@input.space, length - offset].min
+          @input.write(data.map { |c| c[offset...(offset + count)] })
+
+          process_block if @input.full?
+
+          @output.read(count).each_with_index do |c, ear|
+            out[ear][offset...(offset + count)] = c
+          end
+          offset += count
+        end
+
+        out
+      end
+
+      # Clears the convolution history, as if silence had been playing.
+      def reset
+        @fdl.fill(0)
+        @previous_input.fill(0)
+        @input.clear
+        @output.clear
+        @output.write([Numo::DFloat.zeros(@block_size)] * 2)
+        @old_filters = nil
+      end
+
+      private
+
+      # Returns the index of the HRIR nearest the given azimuth.
+      def nearest(azimuth)
+        @azimuths.each_index.min_by { |i|
+          d = (@azimuths[i] - azimuth) % (2 * Math::PI)
+          [d, 2 * Math::PI - d].min
+        }
+      end
+
+      # Convolves one full block from the input ring and writes one block of
+      # both ears to the output ring.
+      def process_block
+        current = Numo::DFloat.zeros(@channels, @block_size)
+        @input.read(@block_size).each_with_index do |c, idx|
+          current[idx, true] = c
+        end
+
+        # Overlap-save: transform the previous and current blocks together
+        window = @previous_input.concatenate(current, axis: 1)
+        @previous_input = current
+
+        @head = (@head + 1) % @partitions
+        @fdl[true, @head, true] = Numo::Pocketfft.rfft(window)
+
+        # Partition p is multiplied by the input spectrum from p blocks ago
+        delayed = @fdl[true, Numo::Int64.new(@partitions).seq(@head + @partitions, -1) % @partitions, true]
+        delayed = delayed.reshape(@channels, 1, @partitions, @bins)
+
+        result = render(delayed, @filters)
+
+        if @old_filters
+          old = render(delayed, @old_filters)
+          result = old * (1.0 - @fade) + result * @fade
+          @old_filters = nil
+        end
+
+        @output.write([result[0, true], result[1, true]])
+      end
+
+      # Sums all channels and partitions in the frequency domain and returns
+      # the new [ear, block_size] output samples.
+      def render(delayed, filters)
+        spectrum = (delayed * filters).sum(axis: [0, 2])
+        Numo::Pocketfft.irfft(spectrum)[true, @block_size..-1]
+      end
+    end
+  end
+end
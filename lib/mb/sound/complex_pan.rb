@@ -19,6 +19,15 @@ module MB
     #
     # You can pass the output of MB::Sound::FFTMethods#analytic_signal or a
     # complex waveform from MB::Sound::Oscillator.
+    #
+    # Pan and phase may be automated per sample, either by setting them to
+    # Numo::NArrays with one value per sample of the next buffer (after which
+    # each holds at its array's last value), or by giving
+    # a +:smoothing+ time to #initialize, in which case changes to #pan and
+    # #phase glide toward their new values with a one-pole curve.  Both are
+    # computed as whole-buffer gain ramps, without a loop over samples.
+    #
+    # See MultichannelPan for panning many signals to more than two speakers.
     class ComplexPan
       # Constant to pass to #initialize for -3dB pan law.
       DB_3 = 0.5 ** 0.5
@@ -29,18 +38,30 @@ module MB
       # Constant to pass to #initialize for -6dB pan law.
       DB_6 = 0.5
 
+      # The target pan and phase.  Each may be a Numeric, or a Numo::NArray
+      # with one value per sample of the next buffer given to #process, which
+      # replaces the array with its last value.
       attr_accessor :pan, :phase
+
       attr_reader :pan_power
 
+      # The pan and phase smoothing time constant in seconds, or nil.
+      attr_reader :smoothing
+
       # Initializes a ComplexPan, defaulting to center-panned and in-phase
       # output.  The +:center_gain+ parameter controls the panning gain curve
-      # (see the class description).
-      def initialize(center_gain: DB_45)
+      # (see the class description).  If +:smoothing+ is given, changes to
+      # #pan and #phase are smoothed with that time constant in seconds at
+      # the sample +:rate+.
+      def initialize(center_gain: DB_45, rate: 48000, smoothing: nil)
         self.center_gain = center_gain
         @pan = 0.0
         @phase = 0.0
 
-        # TODO: Smoothed pan/phase
+        @rate = rate
+        @smoothing = smoothing
+        @coeff = smoothing && smoothing > 0 ? Math.exp(-1.0 / (smoothing * rate)) : nil
+
         @pan_s = 0.0
         @phase_s = 0.0
       end
@@ -56,18 +77,33 @@ module MB
       # Immediately set pan and phase values to their target values, skipping
       # any smoothing curve.  Call #pan= and/or #phase= first, then call this.
       def reset(pan: @pan, phase: @phase)
-        # TODO: reset if there is a smoothing curve
+        @pan = pan
+        @phase = phase
+        @pan_s = final_value(pan)
+        @phase_s = final_value(phase)
       end
 
       # Pans and rotates the given +data+ and returns [l, r] based on the
-      # current settings for :pan and :phase.
+      # current settings for :pan and :phase, smoothed or automated per sample
+      # if +data+ is a Numo::NArray.
       def process(data)
         MB::M.with_inplace(data, false) do |d|
-          # TODO: smooth pan and phase per-sample with a LinearFollower and/or low-pass filter
-          pan = @pan
-          phase = @phase
+          n = d.is_a?(Numo::NArray) ? d.length : 1
+
+          @pan_s, pan = automate(@pan, @pan_s, n)
+          @phase_s, phase = automate(@phase, @phase_s, n)
+
+          # Automation arrays only cover one buffer
+          @pan = final_value(@pan)
+          @phase = final_value(@phase)
 
           lgain, rgain = ComplexPan.gains(pan, phase, @pan_power)
+
+          if d.is_a?(Numo::NArray)
+            lgain = match_type(d, lgain)
+            rgain = match_type(d, rgain)
+          end
+
           return d * lgain, d * rgain
         end
       end
@@ -77,18 +113,69 @@ module MB
       # Math::PI or 180.degrees being exactly out of phase).  The center gain
       # and gain curve is controlled by the +power+ parameter.  A +power+ of 1
       # is -6dB, and a +power+ of 0.5 is -3dB.
+      #
+      # The +pan+ and +phase+ may be Numo::NArrays, in which case arrays of
+      # gains are returned.
       def self.gains(pan, phase, power)
         # TODO: Maybe allow out-of-range pan values for "extra stereo"?
-        r = MB::M.clamp(0.5 * pan + 0.5, 0, 1)
+        if pan.is_a?(Numo::NArray)
+          r = (0.5 * Numo::DFloat.cast(pan) + 0.5).clip(0, 1)
+        else
+          r = MB::M.clamp(0.5 * pan + 0.5, 0, 1)
+        end
         l = 1.0 - r
         l **= power
         r **= power
 
-        l *= Math::E ** (-phase * 0.5i)
-        r *= Math::E ** (phase * 0.5i)
+        if phase.is_a?(Numo::NArray)
+          half = Numo::DFloat.cast(phase) * 0.5
+          cos = Numo::NMath.cos(half)
+          sin = Numo::NMath.sin(half)
+          l = l * (cos - sin * 1i)
+          r = r * (cos + sin * 1i)
+        else
+          # Applied even for zero phase so output is always complex, whether
+          # or not pan is being automated
+          l *= Math::E ** (-phase * 0.5i)
+          r *= Math::E ** (phase * 0.5i)
+        end
 
         return l, r
       end
+
+      private
+
+      # Returns the new smoothed state and the value or per-sample values to
+      # use for the next +n+ samples of a parameter with the given +target+.
+      def automate(target, state, n)
+        if target.is_a?(Numo::NArray)
+          raise ArgumentError, "Automation has #{target.length} values for #{n} samples" unless target.length == n
+          return target[-1], target
+        end
+
+        return target, target if @coeff.nil? || state == target
+
+        # A one-pole filter approaching a constant target has a closed form
+        decay = Numo::NMath.exp(Numo::DFloat.new(n).seq(1) * Math.log(@coeff))
+        values = decay * (state - target) + target
+        state = (values[-1] - target).abs < 1e-9 ? target : values[-1]
+
+        return state, n == 1 ? values[0] : values
+      end
+
+      # Returns the last value of a parameter that may be an NArray.
+      def final_value(v)
+        v.is_a?(Numo::NArray) ? v[-1] : v
+      end
+
+      # Converts an array of gains to a complex Numo type that matches the
+      # precision of +data+, so panning an SFloat gives SComplex results.
+      def match_type(data, gain)
+        return gain unless gain.is_a?(Numo::NArray)
+
+        single = data.is_a?(Numo::SFloat) || data.is_a?(Numo::SComplex)
+        (single ? Numo::SComplex : Numo::DComplex).cast(gain)
+      end
     end
   end
 end
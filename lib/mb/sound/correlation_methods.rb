@@ -0,0 +1,247 @@
+module MB
+  module Sound
+    # Methods for measuring the time offset between recordings using
+    # FFT-based cross-correlation, e.g. to line up multiple microphones or
+    # takes before passing them to WindowMethods#analyze_multi_time_window.
+    # MB::Sound extends itself with this module.
+    #
+    # Correlations are accumulated block by block in the frequency domain,
+    # so only the range of lags being searched determines the FFT size, not
+    # the length of the recordings.  Long recordings are searched at a
+    # decimated sample rate first, then the coarse estimate is refined at
+    # full rate using a short excerpt.
+    #
+    # Example:
+    #     offsets = MB::Sound.find_offsets(['take1.flac', 'take2.flac'])
+    #     inputs = MB::Sound.align_inputs(['take1.flac', 'take2.flac'], offsets)
+    #     MB::Sound.analyze_multi_time_window(inputs, MB::Sound::Window::Hann.new(2048)) do |audio|
+    #       ...
+    #     end
+    module CorrelationMethods
+      # The number of frames to read at a time from input streams.
+      CORRELATION_READ_SIZE = 65536
+
+      # Returns the cross-correlation of the 1D Numo::NArrays +a+ and +b+ as a
+      # Numo::DFloat with 2 * +:max_lag+ + 1 elements.  Index +:max_lag+ + k
+      # holds the correlation at lag k, i.e. the sum of a[n] * b[n + k], so a
+      # peak at a positive lag means +b+ is delayed relative to +a+.
+      #
+      # If +:phat+ is true, the cross-spectrum is whitened using the phase
+      # transform (GCC-PHAT), which sharpens the peak and makes it more robust
+      # to reverberation and tonal content.  The result is then scaled so that
+      # a perfect match has a peak of 1.0.
+      def cross_correlate(a, b, max_lag: nil, phat: false)
+        max_lag ||= [a.length, b.length].max - 1
+        correlate_lags(a, b, -max_lag, max_lag, phat: phat)
+      end
+
+      # Estimates the number of samples by which +other+ is delayed relative
+      # to +reference+ (negative if +other+ starts later in the material).
+      # Each source may be a filename, an input stream, or anything accepted
+      # by ArrayInput; multichannel sources are mixed to mono.  Input streams
+      # are consumed, so pass filenames or data to use the same sources again
+      # with #align_inputs.
+      #
+      # +:max_lag+ - The largest offset in samples to search for (defaults to
+      #              10 seconds).
+      # +:decimation+ - The downsampling factor for the coarse search.
+      #                 Files are downsampled by FFMPEG; streams and data by
+      #                 averaging blocks of samples.
+      # +:refine_length+ - The length in samples of the full-rate excerpt
+      #                    used to refine the coarse estimate (defaults to 5
+      #                    seconds).
+      # +:phat+ - Whether to use GCC-PHAT weighting (see #cross_correlate).
+      # +:subsample+ - If true, returns a Float offset interpolated between
+      #                samples using a parabola fit around the peak.
+      # +:rate+ - The sample rate to use if a source doesn't have one.
+      def find_offset(reference, other, max_lag: nil, decimation: 16, refine_length: nil, phat: true, subsample: false, rate: 48000)
+        raise 'Decimation must be an int >= 1' unless decimation.is_a?(Integer) && decimation >= 1
+
+        rate = reference.rate if reference.respond_to?(:rate)
+        max_lag ||= rate * 10
+        refine_length ||= rate * 5
+        margin = 2 * decimation
+        prefix_length = max_lag + refine_length + 2 * margin
+
+        ref_coarse, ref_prefix, scale = read_for_correlation(reference, decimation, prefix_length, rate)
+        other_coarse, other_prefix, _ = read_for_correlation(other, decimation, prefix_length, rate)
+
+        # Coarse search at the decimated rate
+        coarse_lag = (max_lag / scale).ceil
+        coarse = correlate_lags(ref_coarse, other_coarse, -coarse_lag, coarse_lag, phat: phat)
+        estimate = ((coarse.max_index - coarse_lag) * scale).round
+
+        # Refinement at full rate around the estimate, starting the excerpt
+        # far enough in that both sources have data at every searched lag.
+        # The lags are shifted by the excerpt start so they still index the
+        # whole of the other prefix.
+        start = [0, margin - estimate].max
+        raise 'Not enough audio in the reference to find an offset' if start >= ref_prefix.length
+        excerpt = ref_prefix[start...[start + refine_length, ref_prefix.length].min]
+        fine = correlate_lags(excerpt, other_prefix, estimate - margin + start, estimate + margin + start, phat: phat)
+
+        peak = fine.max_index
+        offset = estimate - margin + peak
+
+        if subsample && peak > 0 && peak < fine.length - 1
+          offset + parabolic_peak(fine[peak - 1], fine[peak], fine[peak + 1])
+        else
+          offset
+        end
+      end
+
+      # Returns an Array with the offset in samples of each of the given
+      # +sources+ relative to the first (so the first element is always 0).
+      # Options are passed to #find_offset.
+      def find_offsets(sources, **options)
+        sources[1..-1].map { |s| find_offset(sources[0], s, **options) }.unshift(0)
+      end
+
+      # Discards leading audio from each of the given +inputs+ (filenames are
+      # opened with IOMethods#file_input) so that they line up according to
+      # the +offsets+ (e.g. from #find_offsets).  Fractional offsets are
+      # rounded.  Returns the Array of input streams.
+      def align_inputs(inputs, offsets)
+        raise 'Must give one offset per input' unless inputs.length == offsets.length
+
+        earliest = offsets.min
+        inputs.each_with_index.map { |input, idx|
+          input = file_input(input) if input.is_a?(String)
+
+          skip = (offsets[idx] - earliest).round
+          while skip > 0
+            data = input.read([skip, CORRELATION_READ_SIZE].min)
+            break if data[0].length == 0
+            skip -= data[0].length
+          end
+
+          input
+        }
+      end
+
+      private
+
+      # Returns the correlation sum of a[n] * b[n + k] for each lag k from
+      # +min_lag+ to +max_lag+.  The sum over n is split into blocks, and each
+      # block's cross-spectrum is accumulated, so the FFT size depends only on
+      # the range of lags.
+      def correlate_lags(a, b, min_lag, max_lag, phat: false)
+        span = max_lag - min_lag
+        block = [2 ** Math.log2(span + 1).ceil, 16384].max
+        fft_length = block * 2
+
+        a = Numo::DFloat.cast(a)
+        b = Numo::DFloat.cast(b)
+        sum = Numo::DComplex.zeros(fft_length / 2 + 1)
+
+        (0...a.length).step(block) do |start|
+          a_block = MB::M.zpad(a[start...[start + block, a.length].min], fft_length)
+          b_block = slice_padded(b, start + min_lag, block + span, fft_length)
+          sum.inplace + real_fft(b_block) * real_fft(a_block).conj
+          sum.not_inplace!
+        end
+
+        if phat
+          sum.inplace / (sum.abs + 1e-30)
+          sum.not_inplace!
+          real_ifft(sum)[0..span] / (fft_length / 2)
+        else
+          # Undo the normalization of real_fft and real_ifft
+          real_ifft(sum)[0..span] * (fft_length / 2)
+        end
+      end
+
+      # Returns +count+ samples of +data+ starting at +start+ (which may be
+      # negative or past the end, filling with zeros), padded with zeros to
+      # +total+ samples.
+      def slice_padded(data, start, count, total)
+        out = Numo::DFloat.zeros(total)
+        from = [start, 0].max
+        to = [start + count, data.length].min
+        out[(from - start)...(to - start)] = data[from...to] if to > from
+        out
+      end
+
+      # Returns the offset of the vertex of a parabola through three equally
+      # spaced points, relative to the middle point.
+      def parabolic_peak(left, center, right)
+        denom = left - 2.0 * center + right
+        return 0.0 if denom == 0
+        0.5 * (left - right) / denom
+      end
+
+      # Reads the given +source+ (a filename, input stream, or data) and
+      # returns a mono Numo::DFloat decimated by about +decimation+, a mono
+      # Numo::DFloat with the first +prefix_length+ samples at full rate, and
+      # the exact decimation ratio.
+      def read_for_correlation(source, decimation, prefix_length, rate)
+        if source.is_a?(String)
+          full = file_input(source, resample: rate)
+          prefix = mix_to_mono(full.read(prefix_length))
+          full.close
+
+          # FFMPEG needs an integer sample rate
+          coarse_rate = (rate.to_f / decimation).round
+          decimated, _ = read_mono(file_input(source, resample: coarse_rate), 1, 0)
+
+          return decimated, prefix, rate.to_f / coarse_rate
+        end
+
+        source = ArrayInput.new(source, rate: rate) unless source.respond_to?(:read)
+        decimated, prefix = read_mono(source, decimation, prefix_length)
+
+        return decimated, prefix, decimation.to_f
+      end
+
+      # Reads all of +input+, mixing to mono and averaging each +decimation+
+      # samples, while keeping the first +prefix_length+ samples at full
+      # rate.  Closes the input.  Returns the decimated and prefix data.
+      def read_mono(input, decimation, prefix_length)
+        prefix = []
+        prefix_count = 0
+        chunks = []
+        carry = Numo::DFloat[]
+
+        loop do
+          data = input.read(CORRELATION_READ_SIZE)
+          break if data.nil? || data[0].length == 0
+
+          mono = mix_to_mono(data)
+
+          if prefix_count < prefix_length
+            keep = mono[0...[prefix_length - prefix_count, mono.length].min]
+            prefix << keep
+            prefix_count += keep.length
+          end
+
+          mono = carry.concatenate(mono) if carry.length > 0
+          count = mono.length / decimation
+          if count > 0
+            chunks << mono[0...(count * decimation)].reshape(count, decimation).mean(axis: 1)
+          end
+          carry = count * decimation < mono.length ? mono[(count * decimation)..-1] : Numo::DFloat[]
+        end
+
+        input.close if input.respond_to?(:close)
+
+        return join_chunks(chunks), join_chunks(prefix)
+      end
+
+      # Averages all channels of +data+ into a Numo::DFloat.
+      def mix_to_mono(data)
+        data.map { |c| Numo::DFloat.cast(c) }.reduce(:+) / data.length
+      end
+
+      # Concatenates an Array of Numo::DFloat into a single Numo::DFloat.
+      def join_chunks(chunks)
+        out = Numo::DFloat.zeros(chunks.sum(&:length))
+        offset = 0
+        chunks.each do |c|
+          out[offset...(offset + c.length)] = c
+          offset += c.length
+        end
+        out
+      end
+    end
+  end
+end
@@ -0,0 +1,142 @@
+module MB
+  module Sound
+    # Converts floating point audio (-1..1) to integer samples for 16-bit,
+    # 24-bit, or 32-bit output, adding triangular (TPDF) dither so that
+    # quantization error becomes benign noise instead of distortion.  The
+    # results are Numo integer arrays (Numo::Int16, or Numo::Int32 for 24-bit
+    # and 32-bit, with 24-bit values in the low 24 bits) that can be written
+    # to a raw integer stream with #pack.
+    #
+    # The +:shaping+ parameter selects how the noise is spectrally shaped:
+    #
+    # nil - Flat TPDF dither (the difference of two uniform random values).
+    # :highpass - TPDF dither from the difference of consecutive uniform
+    #             random values, moving dither noise toward high frequencies.
+    # :error_feedback - Flat TPDF dither plus first-order error feedback,
+    #                   which moves the quantization error itself toward high
+    #                   frequencies.  This is recursive, so it runs a loop over
+    #                   samples and is much slower than the other modes.
+    #
+    # Random values are drawn in bulk from the dither's own Random, seeded
+    # with +:seed+ (or from MB::Sound::Noise::RAND, which honors the
+    # RANDOM_SEED environment variable), so output can be reproduced exactly
+    # and Numo's global random generator is left alone.
+    #
+    # Example:
+    #     dither = MB::Sound::Dither.new(bits: 16, seed: 1)
+    #     ints = dither.process([left, right])
+    #     io.write(dither.pack(ints))
+    class Dither
+      # Shaping options accepted by #initialize.
+      SHAPING = [nil, :highpass, :error_feedback].freeze
+
+      # The number of bits per output sample.
+      attr_reader :bits
+
+      # The noise shaping mode (see SHAPING).
+      attr_reader :shaping
+
+      # The Numo integer class of the output.
+      attr_reader :type
+
+      # Initializes a dither and quantization stage for +:bits+ bit output
+      # (16, 24, or 32).  See the class description for +:shaping+ and
+      # +:seed+.
+      def initialize(bits: 16, shaping: nil, seed: nil)
+        raise 'Bits must be 16, 24, or 32' unless [16, 24, 32].include?(bits)
+        raise "Shaping must be one of #{SHAPING.inspect}" unless SHAPING.include?(shaping)
+
+        @bits = bits
+        @shaping = shaping
+        @type = bits == 16 ? Numo::Int16 : Numo::Int32
+        @scale = 2 ** (bits - 1)
+        @random = Random.new(seed || MB::Sound::Noise::RAND.rand(2 ** 64))
+
+        @last_random = []
+        @last_error = []
+      end
+
+      # Dithers and quantizes an Array of Numo::NArrays (one per channel), or
+      # a single Numo::NArray, returning integer Numo::NArrays of the same
+      # shape.  Noise shaping state is kept for each channel.
+      def process(data)
+        return quantize(data, 0) if data.is_a?(Numo::NArray)
+        data.each_with_index.map { |c, idx| quantize(c, idx) }
+      end
+
+      # Returns the given Array of integer Numo::NArrays (e.g. from #process)
+      # as a String of interleaved samples in native byte order (s16le or
+      # s32le on little-endian machines), for raw integer output streams.
+      def pack(data)
+        data = [data] if data.is_a?(Numo::NArray)
+
+        interleaved = @type.zeros(data[0].length, data.length)
+        data.each_with_index do |c, idx|
+          interleaved[true, idx] = c
+        end
+
+        interleaved.to_binary
+      end
+
+      # Clears noise shaping state.
+      def reset
+        @last_random.clear
+        @last_error.clear
+      end
+
+      private
+
+      # Dithers and quantizes one channel.
+      def quantize(data, channel)
+        n = data.length
+        return @type.zeros(0) if n == 0
+
+        scaled = Numo::DFloat.cast(data) * @scale
+
+        case @shaping
+        when nil
+          scaled.inplace + uniform(n)
+          scaled.inplace - uniform(n)
+          result = scaled.not_inplace!.round
+
+        when :highpass
+          r = uniform(n + 1)
+          r[0] = @last_random[channel] || 0.5
+          @last_random[channel] = r[-1]
+          scaled.inplace + r[1..-1]
+          scaled.inplace - r[0...-1]
+          result = scaled.not_inplace!.round
+
+        when :error_feedback
+          noise = uniform(n) - uniform(n)
+          result = error_feedback(scaled, noise, channel)
+        end
+
+        @type.cast(result.clip(-@scale, @scale - 1))
+      end
+
+      # Returns +n+ uniform random values from 0 (inclusive) to 1 (exclusive)
+      # as a Numo::DFloat, using the dither's own Random.
+      def uniform(n)
+        Numo::DFloat.cast(Numo::UInt32.from_binary(@random.bytes(4 * n))) * (1.0 / 2 ** 32)
+      end
+
+      # Quantizes with first-order error feedback, so the output error is the
+      # difference of consecutive quantization errors.
+      def error_feedback(scaled, noise, channel)
+        error = @last_error[channel] || 0.0
+        noise = noise.to_a
+
+        values = scaled.to_a.each_with_index.map { |v, idx|
+          v -= error
+          q = (v + noise[idx]).round.clamp(-@scale, @scale - 1)
+          error = (q - v).clamp(-2.0, 2.0) # Only reached when clipping
+          q
+        }
+
+        @last_error[channel] = error
+        Numo::DFloat.cast(values)
+      end
+    end
+  end
+end
@@ -0,0 +1,182 @@
+module MB
+  module Sound
+    # Generates an exponential (logarithmic) sine sweep for measuring the
+    # impulse response of a system (a room, speaker, or filter), and recovers
+    # the impulse response from the system's response to the sweep using
+    # Farina's inverse filter.
+    #
+    # The inverse filter is the time-reversed sweep with an exponentially
+    # decaying envelope that compensates for the sweep's pink spectrum, so
+    # that convolving the sweep with its inverse gives a band-limited impulse
+    # with unity gain in the swept band.  Harmonic distortion products land
+    # before the linear impulse response, where they are easy to discard.
+    #
+    # Deconvolution uses uniformly partitioned overlap-save convolution,
+    # streaming the recorded audio through a WindowReader one block at a time
+    # and accumulating only the output blocks that contain the requested part
+    # of the impulse response.  The recording never needs to fit in memory.
+    #
+    # Example:
+    #     sweep = MB::Sound::ExponentialSweep.new(duration: 30)
+    #     sweep.write(MB::Sound.file_output('/tmp/sweep.flac', channels: 1))
+    #     # ...play and record /tmp/sweep.flac through the system to /tmp/rec.flac...
+    #     ir = sweep.deconvolve(MB::Sound.file_input('/tmp/rec.flac'), length: 48000)
+    #     reverb = MB::Sound::Filter::FIR.from_impulse(ir[0])
+    class ExponentialSweep
+      attr_reader :duration, :start_freq, :end_freq, :rate, :amplitude, :fade, :length
+
+      # Initializes a sweep from +:start_freq+ to +:end_freq+ (defaulting to
+      # just under Nyquist) lasting +:duration+ seconds.  The first and last
+      # +:fade+ seconds are faded in and out to avoid clicks.
+      def initialize(duration: 10, start_freq: 20, end_freq: nil, rate: 48000, amplitude: 0.5, fade: 0.01)
+        end_freq ||= rate * 0.45
+
+        raise 'Duration must be positive' unless duration.is_a?(Numeric) && duration > 0
+        raise 'Start frequency must be positive' unless start_freq.is_a?(Numeric) && start_freq > 0
+        raise 'End frequency must be above start frequency' unless end_freq > start_freq
+        raise "End frequency must be less than half the sample rate (#{rate / 2.0})" unless end_freq < rate / 2.0
+
+        @duration = duration
+        @start_freq = start_freq.to_f
+        @end_freq = end_freq.to_f
+        @rate = rate
+        @amplitude = amplitude
+        @fade = fade
+        @length = (duration * rate).round
+        @log_ratio = Math.log(@end_freq / @start_freq)
+      end
+
+      # Returns the sweep as a Numo::SFloat.
+      def sweep
+        @sweep ||= generate_sweep
+      end
+
+      # Returns the inverse filter as a Numo::SFloat.  Convolving the sweep
+      # with the inverse filter gives an impulse at index #length - 1.
+      def inverse
+        @inverse ||= generate_inverse
+      end
+
+      # Writes the sweep to the given +output+ stream, duplicated to all of its
+      # channels.  The final buffer is padded with zeros if the output has a
+      # fixed buffer size.
+      def write(output)
+        buffer_size = output.buffer_size
+        s = sweep
+
+        (0...@length).step(buffer_size) do |start|
+          d = s[start...[start + buffer_size, @length].min]
+          d = MB::M.zpad(d, buffer_size) if d.length < buffer_size
+          output.write([d] * output.channels)
+        end
+      end
+
+      # Recovers the impulse response from a recording of the system's
+      # response to the sweep.  The +input+ may be an input stream (e.g. from
+      # MB::Sound.file_input) or anything accepted by ArrayInput.  Returns an
+      # Array of Numo::SFloat with one impulse response per channel.
+      #
+      # +:length+ - The number of samples of impulse response to return
+      #             (defaults to one second).
+      # +:pre+ - The number of samples before the start of the linear impulse
+      #          response to return, e.g. to capture system latency of unknown
+      #          sign or to inspect the distortion products.
+      # +:block_size+ - The partition size of the convolution.  Larger blocks
+      #                 use fewer, larger FFTs.
+      def deconvolve(input, length: nil, pre: 0, block_size: 16384)
+        input = ArrayInput.new(input, rate: @rate) unless input.respond_to?(:read)
+
+        length ||= @rate
+        raise 'Length must be a positive integer' unless length.is_a?(Integer) && length > 0
+        raise 'Pre must be a non-negative integer' unless pre.is_a?(Integer) && pre >= 0
+
+        # The linear impulse response begins at index (@length - 1) of the
+        # full convolution; only the blocks covering the requested range are
+        # accumulated.
+        first_sample = @length - 1 - pre
+        raise "Pre must be less than the sweep length #{@length}" if first_sample < 0
+        last_sample = first_sample + length + pre - 1
+        first_block = first_sample / block_size
+        last_block = last_sample / block_size
+
+        partitions = inverse_partitions(block_size)
+        outputs = (first_block..last_block).map {
+          input.channels.times.map { Numo::DComplex.zeros(block_size + 1) }
+        }
+
+        window = Window::Rectangular.new(block_size * 2)
+        window.force_hop(block_size)
+        reader = WindowReader.new(input, window)
+
+        # Each read returns the previous and current blocks of input, so
+        # output block j is the sum of input block m times partition j - m.
+        (0..last_block).each do |m|
+          data = reader.read
+          break if data.nil?
+
+          spectra = data.map { |c| MB::Sound.real_fft(c) }
+
+          ([first_block, m].max..[last_block, m + partitions.length - 1].min).each do |j|
+            h = partitions[j - m]
+            outputs[j - first_block].each_with_index do |acc, idx|
+              acc.inplace + spectra[idx] * h
+              acc.not_inplace!
+            end
+          end
+        end
+
+        input.channels.times.map { |idx|
+          blocks = outputs.map { |o| MB::Sound.real_ifft(o[idx])[block_size..-1] }
+          result = blocks.reduce { |a, b| a.concatenate(b) }
+          start = first_sample - first_block * block_size
+          Numo::SFloat.cast(result[start...(start + length + pre)])
+        }
+      end
+
+      private
+
+      # Returns the instantaneous phase of the sweep at time +t+ (a
+      # Numo::DFloat of seconds).
+      def phase(t)
+        2.0 * Math::PI * @start_freq * @duration / @log_ratio * (Numo::NMath.exp(t * (@log_ratio / @duration)) - 1)
+      end
+
+      def generate_sweep
+        t = Numo::DFloat.new(@length).seq / @rate
+        s = Numo::NMath.sin(phase(t)) * @amplitude
+
+        fade_length = [(@fade * @rate).round, @length / 2].min
+        if fade_length > 0
+          ramp = 0.5 - 0.5 * Numo::NMath.cos(Numo::DFloat.new(fade_length).seq * (Math::PI / fade_length))
+          s[0...fade_length] *= ramp
+          s[-fade_length..-1] *= ramp.reverse
+        end
+
+        Numo::SFloat.cast(s)
+      end
+
+      def generate_inverse
+        t = Numo::DFloat.new(@length).seq / @rate
+        inv = Numo::DFloat.cast(sweep.reverse) * Numo::NMath.exp(t * (-@log_ratio / @duration))
+
+        # By the stationary phase approximation, the sweep's magnitude
+        # spectrum is A/2 * sqrt(T / (R * f)) and the envelope scales the
+        # reversed sweep by f / f2, so their product is flat at this value.
+        inv.inplace / (@rate * @amplitude ** 2 * @length / (4.0 * @log_ratio * @end_freq))
+
+        Numo::SFloat.cast(inv)
+      end
+
+      # Splits the inverse filter into zero-padded FFTs of +block_size+
+      # samples each, scaled to undo the normalization of
+      # MB::Sound.real_fft/real_ifft so that products give plain convolution.
+      def inverse_partitions(block_size)
+        @partitions ||= {}
+        @partitions[block_size] ||= (0...@length).step(block_size).map { |start|
+          part = inverse[start...[start + block_size, @length].min]
+          (MB::Sound.real_fft(MB::M.zpad(part, block_size * 2)).inplace * block_size).not_inplace!
+        }
+      end
+    end
+  end
+end
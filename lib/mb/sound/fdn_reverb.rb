@@ -0,0 +1,287 @@
+module MB
+  module Sound
+    # A feedback delay network (FDN) reverb.  Several delay lines of mutually
+    # prime lengths feed back into each other through an orthogonal mixing
+    # matrix, with a gain on each line to set the decay time, and a one-pole
+    # lowpass on each line so high frequencies decay faster.
+    #
+    # All delay lines live in one two-dimensional ring buffer with one row per
+    # line, and audio is processed in blocks no longer than the shortest
+    # delay line.  Nothing written during a block can be read back within the
+    # same block, so each block is a handful of vector operations across all
+    # lines at once: gathering every line's output, filtering it, mixing it
+    # through the feedback matrix with Numo's #dot, and writing it back.
+    #
+    # Example:
+    #     reverb = MB::Sound::FDNReverb.new(rt60: 2.5, damping: 0.4, wet: 0.25)
+    #     output = reverb.process([left, right])
+    class FDNReverb
+      # Supported feedback matrix types.
+      MATRICES = [:householder, :hadamard].freeze
+
+      # The range of default delay line lengths, in seconds, before scaling by
+      # +:size+ and rounding to prime numbers of samples.
+      DEFAULT_DELAY_RANGE = 0.029..0.087
+
+      # The number of audio channels processed.
+      attr_reader :channels
+
+      # The sample rate in Hz.
+      attr_reader :rate
+
+      # The number of delay lines.
+      attr_reader :lines
+
+      # The delay line lengths in samples (an Array of Integers).
+      attr_reader :delays
+
+      # The time in seconds for the reverb tail to decay by 60dB.
+      attr_reader :rt60
+
+      # The coefficient of the one-pole lowpass on each delay line (0 for no
+      # damping, approaching 1 for heavy damping).
+      attr_reader :damping
+
+      # The feedback matrix type (see MATRICES).
+      attr_reader :matrix
+
+      # The output gain of the reverberated signal.
+      attr_accessor :wet
+
+      # The output gain of the original signal.
+      attr_accessor :dry
+
+      # Initializes an FDN reverb.
+      #
+      # +:channels+ - The number of input and output channels.
+      # +:rate+ - The sample rate in Hz.
+      # +:lines+ - The number of delay lines (a power of two, usually 8 or 16).
+      # +:rt60+ - The reverb decay time in seconds.
+      # +:damping+ - The lowpass coefficient on each delay line, from 0 (no
+      #              damping) to less than 1.
+      # +:size+ - Scales the default delay line lengths (larger is roomier).
+      # +:delays+ - An Array of delay line lengths in samples, overriding the
+      #             defaults.
+      # +:matrix+ - :householder or :hadamard.
+      # +:wet+ - The gain of the reverberated signal.
+      # +:dry+ - The gain of the original signal.
+      def initialize(channels: 2, rate: 48000, lines: 8, rt60: 2.0, damping: 0.3, size: 1.0, delays: nil, matrix: :householder, wet: 0.3, dry: 1.0)
+        raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+        raise 'Lines must be a power of two >= 2' unless lines.is_a?(Integer) && lines >= 2 && (lines & (lines - 1)) == 0
+        raise "Matrix must be one of #{MATRICES}" unless MATRICES.include?(matrix)
+        raise 'Damping must be between 0 and 1' unless damping >= 0 && damping < 1
+
+        @channels = channels
+        @rate = rate
+        @lines = lines
+        @matrix = matrix
+        @wet = wet
+        @dry = dry
+
+        @delays = delays || default_delays(lines, size)
+        raise "Expected #{lines} delays, got #{@delays.length}" unless @delays.length == lines
+        raise 'Delays must be integers >= 1' unless @delays.all? { |d| d.is_a?(Integer) && d >= 1 }
+
+        # Blocks can be no longer than the shortest delay
+        @block_size = @delays.min
+        @capacity = @delays.max + @block_size
+        @ring = Numo::SFloat.zeros(lines, @capacity)
+        @write_pos = 0
+
+        # Flat ring indices for each line's read position at the start of a
+        # block, plus an offset for each sample within the block
+        @line_base = Numo::Int64.new(lines, 1).seq * @capacity
+        @line_delays = Numo::Int64.cast(@delays).reshape(lines, 1)
+        @block_seq = Numo::Int64.new(1, @block_size).seq
+
+        @feedback = feedback_matrix(lines, matrix)
+        @input_gains = input_matrix(lines, channels)
+        @output_gains = output_matrix(lines, channels)
+
+        @filter_state = Numo::DFloat.zeros(lines)
+        @output = Numo::SFloat.zeros(channels, @block_size)
+
+        self.rt60 = rt60
+        self.damping = damping
+      end
+
+      # Sets the decay time in seconds, recalculating the gain of each line.
+      def rt60=(rt60)
+        raise 'RT60 must be positive' unless rt60.is_a?(Numeric) && rt60 > 0
+        @rt60 = rt60
+
+        # Each pass through a line of length m must decay by m / (rt60 * rate)
+        # of 60dB.
+        exponents = Numo::DFloat.cast(@delays) * (-3.0 / (rt60 * @rate))
+        @line_gains = (10 ** exponents).reshape(@lines, 1)
+      end
+
+      # Sets the lowpass coefficient of each delay line, from 0 (no damping)
+      # to less than 1 (heavy damping).
+      def damping=(damping)
+        raise 'Damping must be between 0 and 1' unless damping.is_a?(Numeric) && damping >= 0 && damping < 1
+        @damping = damping
+
+        return if damping == 0
+
+        # The one-pole filter is run on chunks using a closed form that
+        # multiplies by damping**-k, so chunks are limited to keep that
+        # within the range of a double.
+        @chunk_size = [(150 / -Math.log10(damping)).floor, @block_size].min
+        @chunk_size = 1 if @chunk_size < 1
+        k = Numo::DFloat.new(@chunk_size).seq
+        @powers = damping ** k
+        @inverse_powers = damping ** -k
+      end
+
+      # Clears the delay lines and filters.
+      def reset
+        @ring.fill(0)
+        @filter_state.fill(0)
+        @write_pos = 0
+        self
+      end
+
+      # Processes an Array of Numo::NArrays (one per channel), returning an
+      # Array of Numo::SFloat with the reverberated output mixed with the dry
+      # input.  The returned arrays are views of an internal buffer that is
+      # reused by the next call.
+      def process(data)
+        raise "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+
+        length = data[0].length
+        @output = Numo::SFloat.zeros(@channels, length) if @output.shape[1] < length
+
+        (0...length).step(@block_size) do |start|
+          n = [@block_size, length - start].min
+          input = Numo::SFloat.zeros(@channels, n)
+          data.each_with_index do |c, idx|
+            input[idx, true] = c[start...(start + n)]
+          end
+
+          @output[true, start...(start + n)] = process_block(input, n)
+        end
+
+        @channels.times.map { |c| @output[c, 0...length] }
+      end
+
+      private
+
+      # Runs one block of +n+ samples (at most the shortest delay) through
+      # the network.  Returns the [channels, n] output.
+      def process_block(input, n)
+        # The output of every line for the whole block, gathered at once
+        idx = @block_seq[true, 0...n] + (@write_pos - @line_delays + @capacity)
+        idx.inplace % @capacity
+        idx.inplace + @line_base
+        line_out = Numo::DFloat.cast(@ring[idx.not_inplace!]).reshape(@lines, n)
+
+        line_out = lowpass(line_out) if @damping > 0
+
+        output = @output_gains.dot(line_out)
+        output.inplace * (@wet / Math.sqrt(@lines))
+        output.inplace + input * @dry
+
+        feedback = @feedback.dot(line_out * @line_gains)
+        feedback.inplace + @input_gains.dot(input)
+        write_lines(feedback.not_inplace!, n)
+
+        output.not_inplace!
+      end
+
+      # Applies each line's one-pole lowpass, y[j] = (1 - g) * x[j] + g *
+      # y[j - 1], to the [lines, n] block using the closed form y[j] = g**j *
+      # (g * y[-1] + (1 - g) * sum(x[k] * g**-k for k in 0..j)).
+      def lowpass(block)
+        g = @damping
+        n = block.shape[1]
+
+        (0...n).step(@chunk_size) do |start|
+          count = [@chunk_size, n - start].min
+          chunk = block[true, start...(start + count)]
+
+          sums = (chunk * @inverse_powers[0...count]).cumsum(axis: 1)
+          sums.inplace * (1 - g)
+          sums.inplace + (@filter_state * g).reshape(@lines, 1)
+          sums.inplace * @powers[0...count]
+
+          block[true, start...(start + count)] = sums
+          @filter_state = sums[true, -1].dup
+        end
+
+        block
+      end
+
+      # Writes the [lines, n] +data+ at the write position of all lines.
+      def write_lines(data, n)
+        first = [n, @capacity - @write_pos].min
+        @ring[true, @write_pos...(@write_pos + first)] = data[true, 0...first]
+        @ring[true, 0...(n - first)] = data[true, first...n] if first < n
+        @write_pos = (@write_pos + n) % @capacity
+      end
+
+      # Returns the default delay lengths: prime numbers of samples spread
+      # exponentially across DEFAULT_DELAY_RANGE.
+      def default_delays(lines, size)
+        min = DEFAULT_DELAY_RANGE.begin * size * @rate
+        max = DEFAULT_DELAY_RANGE.end * size * @rate
+
+        lines.times.each_with_object([]) { |i, delays|
+          d = next_prime((min * (max / min) ** (i.to_f / (lines - 1))).round)
+          d = next_prime(d + 1) while delays.include?(d)
+          delays << d
+        }
+      end
+
+      def next_prime(n)
+        n += 1 until prime?(n)
+        n
+      end
+
+      def prime?(n)
+        return false if n < 2
+        (2..Math.sqrt(n)).none? { |f| n % f == 0 }
+      end
+
+      # Returns an orthogonal [lines, lines] feedback matrix.
+      def feedback_matrix(lines, type)
+        case type
+        when :householder
+          Numo::DFloat.eye(lines) - 2.0 / lines
+
+        when :hadamard
+          hadamard(lines) / Math.sqrt(lines)
+        end
+      end
+
+      # Returns a Sylvester Hadamard matrix of size +n+ (a power of two).
+      def hadamard(n)
+        h = Numo::DFloat[[1]]
+        while h.shape[0] < n
+          h = Numo::DFloat.vstack([h.concatenate(h, axis: 1), h.concatenate(-h, axis: 1)])
+        end
+        h
+      end
+
+      # Returns a [lines, channels] matrix that feeds each input channel into
+      # its own subset of the delay lines, so that identical channels still
+      # give decorrelated outputs.
+      def input_matrix(lines, channels)
+        m = Numo::DFloat.zeros(lines, channels)
+        lines.times do |l|
+          m[l, l % channels] = 1
+        end
+        m
+      end
+
+      # Returns a [channels, lines] matrix of +1/-1 gains, using different
+      # rows of a Hadamard matrix for each channel (skipping the all-ones row)
+      # so that each channel hears a different mix of the lines.
+      def output_matrix(lines, channels)
+        h = hadamard(lines)
+        rows = channels.times.map { |c| h[(c + 1) % lines, true] }
+        Numo::DFloat.vstack(rows)
+      end
+    end
+  end
+end
@@ -4,6 +4,11 @@ module MB
     # implement.  For implementation examples see MB::Sound::Filter::Biquad or
     # MB::Sound::Filter::FilterChain.
     class Filter
+      # Recursive filters flush state values smaller than this (-300dB) to
+      # zero, so decaying silence never reaches tiny or subnormal Floats, which
+      # are much slower to process (see bin/denormal_benchmark.rb).
+      DENORMAL_THRESHOLD = 1e-15
+
       # Should accept either a Float or a Numo::NArray (e.g. Numo::SFloat) and
       # return the single sample or array of samples as processed through the
       # filter.
@@ -38,6 +43,16 @@ module MB
         process(process(samples).reverse).reverse
       end
 
+      # Returns the number of samples by which this filter's output lags its
+      # input, beyond what is described by its #response (e.g. for block
+      # processing).  Delay that is part of the #response, such as the phase
+      # of a linear-phase impulse or a Delay filter's delay, is not latency.
+      # FilterSum uses this to keep parallel branches aligned.  Most filters
+      # process sample by sample and have no latency.
+      def latency
+        0
+      end
+
       # Appends another filter after this filter, returning a filter chain.
       def chain(next_filter)
         FilterChain.new(self, next_filter)
@@ -81,3 +96,4 @@ require_relative 'filter/butterworth'
 require_relative 'filter/simple_envelope_follower'
 require_relative 'filter/fir'
 require_relative 'filter/linear_follower'
+require_relative 'filter/delay'
@@ -10,6 +10,13 @@ module MB
       # See https://www.earlevel.com/main/2013/10/13/biquad-calculator-v2/
       # See http://rs-met.com/documents/dsp/BasicDigitalFilters.pdf
       class Biquad < Filter
+        # Real Numo::NArrays at least this long are processed by
+        # #process_vector instead of one sample at a time.
+        VECTOR_MIN = 64
+
+        # The maximum block length used by #process_vector.
+        BLOCK_SIZE = 1024
+
         attr_reader :b0, :b1, :b2, :a1, :a2
 
         # Initializes a biquad filter from the given set of poles and zeros.
@@ -146,14 +153,24 @@ module MB
 
         # Processes +samples+ through the filter, updating the internal state
         # along the way.  If +reset+ is given, the internal state is reset to the
-        # first sample before processing.
+        # first sample before processing.  Outputs smaller than
+        # DENORMAL_THRESHOLD are flushed to zero.
         #
         # If +samples+ is a Numo::NArray in in-place mode, then the samples will
         # be processed in-place, saving an array allocation.
+        #
+        # Real Numo::NArrays of at least VECTOR_MIN samples are processed in
+        # blocks of up to BLOCK_SIZE without a Ruby loop per sample (see
+        # #process_vector).
         def process(samples)
+          if samples.length >= VECTOR_MIN && (samples.is_a?(Numo::SFloat) || samples.is_a?(Numo::DFloat))
+            return process_vector(samples)
+          end
+
           # Direct Form I
           samples.map do |x0|
             out = @b0 * x0 + @b1 * @x1 + @b2 * @x2 - @a1 * @y1 - @a2 * @y2
+            out = 0.0 if out.abs < DENORMAL_THRESHOLD
             @y2 = @y1
             @y1 = out
             @x2 = @x1
@@ -162,6 +179,46 @@ module MB
           end
         end
 
+        # Processes a real Numo::NArray through the filter in blocks, giving the
+        # same result as the sample-by-sample Direct Form I loop (to within
+        # rounding).  Within each block the numerator is applied with shifted
+        # array operations, the previous outputs are folded into the first two
+        # samples, and the recursive denominator is applied by FFT convolution
+        # with the cached impulse response of 1 / (1 + a1 z^-1 + a2 z^-2).
+        def process_vector(samples)
+          count = samples.length
+          out = samples.inplace? ? samples : samples.class.zeros(count)
+          size = [count, BLOCK_SIZE].min
+          spectrum = recursive_spectrum(size)
+
+          (0...count).step(size) do |start|
+            len = [size, count - start].min
+            x = Numo::DFloat.cast(samples[start...(start + len)])
+
+            v = x * @b0
+            v[0] += @b1 * @x1 + @b2 * @x2 - @a1 * @y1 - @a2 * @y2
+            if len > 1
+              v[1..-1] += x[0...-1] * @b1
+              v[1] += @b2 * @x1 - @a2 * @y1
+            end
+            v[2..-1] += x[0...-2] * @b2 if len > 2
+
+            padded = Numo::DFloat.zeros(2 * size)
+            padded[0...len] = v
+            y = Numo::Pocketfft.irfft(Numo::Pocketfft.rfft(padded).inplace * spectrum)[0...len]
+
+            @x2 = len > 1 ? x[-2] : @x1
+            @x1 = x[-1]
+            @y2 = len > 1 ? y[-2] : @y1
+            @y1 = y[-1]
+            flush_denormals
+
+            out[start...(start + len)] = y
+          end
+
+          out
+        end
+
         # Processes one +sample+ through the filter, with +strength+ (a value
         # between 0.0 and 1.0) blending between the incoming +sample+ (at 0.0)
         # and the filter output (at 1.0).  The filter's internal state is updated
@@ -169,12 +226,49 @@ module MB
         def weighted_process(sample, strength = 1.0)
           out = @b0 * sample + @b1 * @x1 + @b2 * @x2 - @a1 * @y1 - @a2 * @y2
           out = strength * out + (1.0 - strength) * sample
+          out = 0.0 if out.abs < DENORMAL_THRESHOLD
           @y2 = @y1
           @y1 = out
           @x2 = @x1
           @x1 = sample
           out
         end
+
+        private
+
+        # Sets internal state values below DENORMAL_THRESHOLD to zero, so that
+        # silence after a block ends in exact zeros instead of decaying further.
+        def flush_denormals
+          @x1 = 0.0 if @x1.abs < DENORMAL_THRESHOLD
+          @x2 = 0.0 if @x2.abs < DENORMAL_THRESHOLD
+          @y1 = 0.0 if @y1.abs < DENORMAL_THRESHOLD
+          @y2 = 0.0 if @y2.abs < DENORMAL_THRESHOLD
+        end
+
+        # Returns the real FFT of the first +size+ samples of the impulse
+        # response of the recursive part of the filter, zero-padded to twice
+        # +size+ for linear convolution.  Cached until the size or denominator
+        # coefficients change.
+        def recursive_spectrum(size)
+          key = [size, @a1, @a2]
+          return @recursive_spectrum if @recursive_key == key
+
+          h = Numo::DFloat.zeros(2 * size)
+          y1 = 0.0
+          y2 = 0.0
+          x = 1.0
+          size.times do |idx|
+            y0 = x - @a1 * y1 - @a2 * y2
+            y0 = 0.0 if y0.abs < DENORMAL_THRESHOLD
+            h[idx] = y0
+            y2 = y1
+            y1 = y0
+            x = 0.0
+          end
+
+          @recursive_key = key
+          @recursive_spectrum = Numo::Pocketfft.rfft(h)
+        end
       end
     end
   end
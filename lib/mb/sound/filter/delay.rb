@@ -0,0 +1,400 @@
+module MB
+  module Sound
+    class Filter
+      # A multichannel delay line with integer or fractional delays, for
+      # building chorus, flanger, comb, and latency compensation effects.
+      #
+      # Audio is stored in a preallocated two-dimensional ring buffer with one
+      # row per channel, and every read gathers all channels at once using
+      # the same index arrays, so work is vectorized across channels.  All
+      # scratch buffers are preallocated as well, so processing blocks no
+      # larger than +:buffer_size+ allocates no sample data in steady state.
+      # Returned buffers are reused on the next call, so copy them if they
+      # need to be kept.
+      #
+      # The delay may be a Numeric number of samples, or a Numo::NArray with
+      # one delay per sample of the block being processed (for modulation).
+      # Supported +:interpolation+ types for fractional delays:
+      #
+      # :none - Rounds to the nearest whole sample.
+      # :linear - Two-point linear interpolation.
+      # :lagrange - Four-point third-order Lagrange interpolation.  Flatter
+      #             high-frequency response than linear; minimum delay 1.
+      # :allpass - First-order Thiran allpass interpolation.  Flat magnitude
+      #            response, but the recursion must run sample by sample, and
+      #            quickly changing delays will cause transients; minimum
+      #            delay 1.
+      #
+      # Multiple taps can be read from the same delay line by calling #write
+      # once, then #read once for each tap.
+      #
+      # Example:
+      #     # Stereo chorus with a 1Hz modulated delay of 10ms +/- 2ms
+      #     delay = MB::Sound::Filter::Delay.new(channels: 2, max_delay: 960, interpolation: :lagrange)
+      #     lfo = 1.hz.at(96).generate(800) + 480 # one block of delay values
+      #     delay.delay = lfo
+      #     out = delay.process([left, right])
+      class Delay < Filter
+        # Supported interpolation types (see the class description).
+        INTERPOLATIONS = [:none, :linear, :lagrange, :allpass].freeze
+
+        # The minimum delay supported by each interpolation type.
+        MIN_DELAYS = { none: 0, linear: 0, lagrange: 1, allpass: 1 }.freeze
+
+        # The number of channels in the delay line.
+        attr_reader :channels
+
+        # The longest delay, in samples, that the delay line can hold.
+        attr_reader :max_delay
+
+        # The interpolation type (see the class description).
+        attr_reader :interpolation
+
+        # The largest block size that can be processed without splitting.
+        attr_reader :buffer_size
+
+        # The current delay in samples (a Numeric or Numo::NArray).
+        attr_reader :delay
+
+        # Initializes a delay line with the given +:delay+ in samples.
+        #
+        # +:max_delay+ - The longest delay that will be used (defaults to the
+        #                initial delay).
+        # +:channels+ - The number of channels to delay.  For more than one
+        #               channel, #process expects an Array of Numo::NArrays
+        #               or a two-dimensional Numo::NArray of [channels, samples].
+        # +:interpolation+ - The interpolation type for fractional delays.
+        # +:buffer_size+ - The largest block that will be processed at once.
+        def initialize(delay: 0, max_delay: nil, channels: 1, interpolation: :linear, buffer_size: 1024)
+          raise "Interpolation must be one of #{INTERPOLATIONS}" unless INTERPOLATIONS.include?(interpolation)
+          raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+          raise 'Buffer size must be an int >= 1' unless buffer_size.is_a?(Integer) && buffer_size >= 1
+
+          max_delay ||= delay.is_a?(Numo::NArray) ? delay.max : delay
+          raise 'Max delay must be a non-negative number' unless max_delay.is_a?(Numeric) && max_delay >= 0
+
+          @channels = channels
+          @max_delay = max_delay
+          @interpolation = interpolation
+          @buffer_size = buffer_size
+          @min_delay = MIN_DELAYS[interpolation]
+
+          # Extra space for the interpolation taps on either side of a read
+          @capacity = max_delay.ceil + buffer_size + 4
+          @ring = Numo::SFloat.zeros(channels, @capacity)
+          @write_count = 0
+          @last_length = 0
+          @last_form = nil
+
+          @seq = Numo::DFloat.new(buffer_size).seq
+          @pos = Numo::DFloat.zeros(buffer_size)
+          @whole = Numo::DFloat.zeros(buffer_size)
+          @frac = Numo::SFloat.zeros(buffer_size)
+          @idx = Numo::Int64.zeros(buffer_size)
+          @tap_idx = Numo::Int64.zeros(buffer_size)
+          @tmp = Numo::SFloat.zeros(channels, buffer_size)
+          @scratch = Numo::SFloat.zeros(8, buffer_size)
+
+          @outputs = {}
+          @allpass_state = {}
+
+          self.delay = delay
+        end
+
+        # Sets the delay in samples, as a Numeric or as a Numo::NArray with
+        # one value for each sample of the next block to be processed.
+        def delay=(delay)
+          raise 'Delay must be Numeric or a Numo::NArray' unless delay.is_a?(Numeric) || delay.is_a?(Numo::NArray)
+          check_delay(delay)
+          @delay = delay
+        end
+
+        # Writes +samples+ to the delay line and returns them delayed by the
+        # current #delay.  Accepts a Numeric (for a single channel), a
+        # Numo::NArray, or an Array of Numo::NArrays (one per channel), and
+        # returns the same type.  Blocks longer than #buffer_size are split.
+        def process(samples)
+          if samples.is_a?(Numeric)
+            raise 'Single samples may only be processed by a single-channel delay' unless @channels == 1
+            return process(Numo::SFloat[samples])[0]
+          end
+
+          length = input_length(samples)
+          raise 'Delay NArray must have one value per sample' if @delay.is_a?(Numo::NArray) && @delay.length != length
+
+          out = output_buffer(:process, length)
+
+          (0...length).step(@buffer_size) do |start|
+            n = [@buffer_size, length - start].min
+            write_block(samples, start, n)
+
+            d = @delay.is_a?(Numo::NArray) && length > n ? @delay[start...(start + n)] : @delay
+            read_block(d, n, out, start, :process)
+          end
+
+          format_output(samples, out, length)
+        end
+
+        # Writes a block of +samples+ (at most #buffer_size long, in any form
+        # accepted by #process) to the delay line without reading it back.
+        # Use #read to read one or more taps.
+        def write(samples)
+          samples = Numo::SFloat[samples] if samples.is_a?(Numeric)
+          length = input_length(samples)
+          raise "Block of #{length} is longer than the buffer size #{@buffer_size}" if length > @buffer_size
+
+          write_block(samples, 0, length)
+          @last_form = samples
+          @last_length = length
+
+          nil
+        end
+
+        # Reads the most recently written block delayed by +delay+ samples
+        # (Numeric or Numo::NArray), returning the same type given to #write.
+        # Each +:tap+ (any Hash key) has its own output buffer and allpass
+        # state, so the results of different taps may be kept until the next
+        # read of the same tap.
+        def read(delay = @delay, tap: 0)
+          raise 'Nothing has been written' if @last_form.nil?
+          raise 'Delay NArray must have one value per sample' if delay.is_a?(Numo::NArray) && delay.length != @last_length
+          check_delay(delay)
+
+          out = output_buffer([:tap, tap], @last_length)
+          read_block(delay, @last_length, out, 0, [:tap, tap])
+          format_output(@last_form, out, @last_length)
+        end
+
+        # Returns zero, as the delay is part of the filter's #response rather
+        # than latency (see Filter#latency), so a FilterSum does not undo an
+        # intentional delay by delaying its other branches.
+        def latency
+          0
+        end
+
+        # Fills the delay line with the given +value+, returning +value+ as
+        # the steady-state output.
+        def reset(value = 0)
+          @ring.fill(value)
+          @allpass_state.each_value do |s| s.fill(value) end
+          value
+        end
+
+        # Returns the frequency response of an ideal delay of the current
+        # #delay (or its average, if modulated) at the given angular frequency.
+        def response(omega)
+          d = @delay.is_a?(Numo::NArray) ? @delay.mean : @delay
+
+          if omega.is_a?(Numo::NArray)
+            Numo::NMath.exp(Numo::DComplex.cast(omega) * Complex(0, -d))
+          else
+            Complex.polar(1.0, -omega * d)
+          end
+        end
+
+        private
+
+        # Raises an error if the +delay+ is outside of the supported range.
+        def check_delay(delay)
+          min, max = delay.is_a?(Numo::NArray) ? [delay.min, delay.max] : [delay, delay]
+          if min < @min_delay || max > @max_delay
+            raise ArgumentError, "Delay must be between #{@min_delay} and #{@max_delay} for #{@interpolation} interpolation (got #{min}..#{max})"
+          end
+        end
+
+        # Returns the number of samples in the given input.
+        def input_length(samples)
+          case samples
+          when Array
+            raise "Expected #{@channels} channels, got #{samples.length}" unless samples.length == @channels
+            samples[0].length
+
+          when Numo::NArray
+            if samples.ndim == 2
+              raise "Expected #{@channels} channels, got #{samples.shape[0]}" unless samples.shape[0] == @channels
+              samples.shape[1]
+            else
+              raise "Expected #{@channels} channels, got 1" unless @channels == 1
+              samples.length
+            end
+
+          else
+            raise "Unsupported input type #{samples.class}"
+          end
+        end
+
+        # Returns a [channels, length] output buffer for +key+, growing it if
+        # necessary.
+        def output_buffer(key, length)
+          buf = @outputs[key]
+          if buf.nil? || buf.shape[1] < length
+            buf = @outputs[key] = Numo::SFloat.zeros(@channels, [length, @buffer_size].max)
+          end
+          buf
+        end
+
+        # Returns views of the first +length+ samples of the +out+ buffer in
+        # the same form as the +samples+ given to #process or #write.
+        def format_output(samples, out, length)
+          case samples
+          when Array
+            @channels.times.map { |c| out[c, 0...length] }
+
+          else
+            samples.ndim == 2 ? out[true, 0...length] : out[0, 0...length]
+          end
+        end
+
+        # Copies +n+ samples of +samples+ starting at +start+ into the ring.
+        def write_block(samples, start, n)
+          pos = @write_count % @capacity
+          first = [n, @capacity - pos].min
+
+          @channels.times do |c|
+            src = channel_data(samples, c)
+            @ring[c, pos...(pos + first)] = src[start...(start + first)]
+            @ring[c, 0...(n - first)] = src[(start + first)...(start + n)] if first < n
+          end
+
+          @write_count += n
+        end
+
+        def channel_data(samples, c)
+          return samples[c] if samples.is_a?(Array)
+          samples.ndim == 2 ? samples[c, true] : samples
+        end
+
+        # Reads the last +n+ samples written, delayed by +delay+, into +out+
+        # starting at +offset+.  The +key+ selects the allpass state.
+        def read_block(delay, n, out, offset, key)
+          o = out[true, offset...(offset + n)]
+
+          # Ring position of the first sample of the block, plus one full
+          # ring so that delayed positions stay positive
+          base = (@write_count - n) % @capacity + @capacity
+
+          # Rounding for :none, and see #read_allpass
+          pos = @pos[0...n]
+          pos.store(@seq[0...n])
+          pos.inplace + base
+          pos.inplace - delay
+          pos.inplace + 0.5 if @interpolation == :none || @interpolation == :allpass
+
+          # Split into whole and fractional sample positions
+          whole = @whole[0...n]
+          whole.store(pos)
+          whole.inplace.floor
+          whole.not_inplace!
+          pos.inplace - whole
+          pos.not_inplace!
+
+          frac = @frac[0...n]
+          frac.store(pos)
+          idx = @idx[0...n]
+          idx.store(whole)
+          idx.inplace % @capacity
+          idx.not_inplace!
+
+          case @interpolation
+          when :none
+            o.store(@ring[true, idx])
+
+          when :linear
+            o.store(@ring[true, idx])
+            t = @tmp[true, 0...n]
+            t.store(@ring[true, tap_index(idx, 1, n)])
+            t.inplace - o
+            t.inplace * frac
+            o.inplace + t
+            o.not_inplace!
+
+          when :lagrange
+            read_lagrange(o, idx, frac, n)
+
+          when :allpass
+            read_allpass(o, idx, frac, n, key)
+          end
+        end
+
+        # Returns an index array offset by +offset+ samples from +idx+.
+        def tap_index(idx, offset, n)
+          t = @tap_idx[0...n]
+          t.store(idx)
+          t.inplace + (offset + @capacity)
+          t.inplace % @capacity
+          t.not_inplace!
+        end
+
+        # Four-point Lagrange interpolation between idx - 1 and idx + 2.
+        def read_lagrange(o, idx, frac, n)
+          fp1, f, fm1, fm2 = 4.times.map { |i|
+            @scratch[i, 0...n].tap { |s|
+              s.store(frac)
+              s.inplace + (1 - i)
+              s.not_inplace!
+            }
+          }
+
+          weights = [
+            [[f, fm1, fm2], -1.0 / 6],
+            [[fp1, fm1, fm2], 0.5],
+            [[fp1, f, fm2], -0.5],
+            [[fp1, f, fm1], 1.0 / 6],
+          ]
+
+          t = @tmp[true, 0...n]
+          weights.each_with_index do |(factors, scale), i|
+            w = @scratch[4 + i, 0...n]
+            w.store(factors[0])
+            w.inplace * factors[1]
+            w.inplace * factors[2]
+            w.inplace * scale
+            w.not_inplace!
+
+            if i == 0
+              o.store(@ring[true, tap_index(idx, -1, n)])
+              o.inplace * w
+            else
+              t.store(@ring[true, tap_index(idx, i - 1, n)])
+              t.inplace * w
+              o.inplace + t
+            end
+            o.not_inplace!
+          end
+        end
+
+        # First-order allpass (Thiran) interpolation.  The read position was
+        # moved half a sample later before rounding down, so reading from
+        # idx + 1 and idx leaves a fractional delay of 1.5 - frac, between
+        # 0.5 and 1.5 where the allpass phase delay is most accurate.
+        def read_allpass(o, idx, frac, n, key)
+          t = @tmp[true, 0...n]
+          o.store(@ring[true, tap_index(idx, 1, n)])
+          t.store(@ring[true, idx])
+
+          # Fractional delay d = 1.5 - frac; eta = (1 - d) / (1 + d)
+          eta = @scratch[0, 0...n]
+          denom = @scratch[1, 0...n]
+          eta.store(frac)
+          eta.inplace - 0.5
+          denom.store(frac)
+          denom.inplace * -1
+          denom.inplace + 2.5
+          eta.inplace / denom
+          eta.not_inplace!
+
+          state = (@allpass_state[key] ||= Numo::SFloat.zeros(@channels))
+
+          @channels.times do |c|
+            y1 = state[c]
+            n.times do |j|
+              y1 = eta[j] * (o[c, j] - y1) + t[c, j]
+              o[c, j] = y1
+            end
+            state[c] = y1
+          end
+        end
+      end
+    end
+  end
+end
@@ -40,6 +40,12 @@ module MB
           @filters.reduce(value) { |v, f| f.reset(v) }
         end
 
+        # Returns the total latency of all filters in the chain (see
+        # Filter#latency).
+        def latency
+          @filters.sum { |f| f.respond_to?(:latency) ? f.latency : 0 }
+        end
+
         # Computes the combined response of all filters at the given angular
         # frequency on the unit circle, by multiplying the responses of all of
         # the filters.  Raises an error if any underlying filters do not support
@@ -3,30 +3,106 @@ module MB
     class Filter
       # A parallel set of filters, all fed the same input, with the outputs
       # summed.
+      #
+      # Filters with different latencies (see Filter#latency), such as an FIR
+      # filter in parallel with a Biquad, would comb filter when summed, so by
+      # default a Delay is added after each lower-latency filter to line its
+      # output up with the highest-latency filter.  Latencies are checked
+      # again before each use, so the delays follow any filter whose latency
+      # changes.
       class FilterSum < Filter
+        # The filters given to the constructor.
+        attr_reader :filters
+
         # Initializes a filter sum with the given filters.  All filters receive
-        # the original input, and are added to produce the final output.
-        def initialize(*filters)
+        # the original input, and are added to produce the final output.  If
+        # +:compensate+ is true, lower-latency filters are delayed to match the
+        # highest-latency filter.
+        def initialize(*filters, compensate: true)
           @filters = filters
+          @compensate = compensate
+          @delays = {}
+          @latencies = nil
+          update_branches
+        end
+
+        # The filters actually processed, including any latency compensation
+        # delays.
+        def branches
+          update_branches
+          @branches
+        end
+
+        # The latency of the filter sum, which is the highest latency of any
+        # of its filters if compensating, or the lowest latency if not (the
+        # remaining latency of each filter is then included in #response).
+        def latency
+          update_branches
+          @latency
         end
 
         # Processes the given sequence of samples (the array index is time)
         # through all filters, adding the output of each filter at each time
         # index.
         def process(samples)
-          @filters.map { |f|
+          update_branches
+
+          @branches.map { |f|
             f.process(samples)
           }.reduce { |acc, d|
             acc ? acc + d.not_inplace! : d.clone.inplace!
           }.not_inplace!
         end
 
-        # Returns the summed responses of all filters.
+        # Returns the summed responses of all filters, with each filter's
+        # latency and compensation delay beyond the sum's #latency applied, so
+        # the result describes the output of #process.
         def response(omega)
           raise 'Not all filters support #response' unless @filters.all? { |f| f.respond_to?(:response) }
 
-          @filters.reduce(0.0) { |acc, f|
-            acc + f.response(omega)
+          update_branches
+
+          @filters.each_with_index.reduce(0.0) { |acc, (f, idx)|
+            r = f.response(omega)
+
+            lag = @latencies[idx] + @extra[idx] - @latency
+            if lag != 0
+              if omega.is_a?(Numo::NArray)
+                r = r * Numo::NMath.exp(Numo::DComplex.cast(omega) * Complex(0, -lag))
+              else
+                r = r * Complex.polar(1.0, -omega * lag)
+              end
+            end
+
+            acc + r
+          }
+        end
+
+        private
+
+        # Rebuilds the processing branches if any filter's latency has changed
+        # since the last call, reusing compensation delays where possible.
+        def update_branches
+          latencies = @filters.map { |f| f.respond_to?(:latency) ? f.latency : 0 }
+          return if latencies == @latencies
+
+          @latencies = latencies
+          max = latencies.max || 0
+          @latency = @compensate ? max : (latencies.min || 0)
+          @extra = latencies.map { |l| @compensate ? max - l : 0 }
+
+          @branches = @filters.each_with_index.map { |f, idx|
+            extra = @extra[idx]
+            next f unless extra > 0
+
+            delay = @delays[idx]
+            if delay && delay.max_delay >= extra
+              delay.delay = extra
+            else
+              delay = @delays[idx] = Delay.new(delay: extra)
+            end
+
+            FilterChain.new(f, delay)
           }
         end
       end
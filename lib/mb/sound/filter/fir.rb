@@ -18,9 +18,6 @@ module MB
       # based solely on the closest-spaced frequencies in the gain map.  This
       # may be improved in the future to take slope into account.
       #
-      # TODO: Allow specifying a time-domain impulse response
-      # TODO: Add getters to return the processing delay, total delay, and impulse delay
-      #
       # Examples:
       #
       #     # Bass cut (added 200Hz so that extrapolated slope for Nyquist is flat)
@@ -30,6 +27,9 @@ module MB
       #     # better the bass response)
       #     rotation = Complex.polar(1, Math::PI / 4)
       #     MB::Sound::Filter::FIR.new(gains: { 20 => rotation, 100 => rotation })
+      #
+      #     # Measured impulse response (see MB::Sound::ExponentialSweep)
+      #     MB::Sound::Filter::FIR.from_impulse(ir)
       class FIR < Filter
         attr_reader :filter_length, :window_length, :rate, :gain_map, :filter_fft, :gains, :impulse
 
@@ -46,6 +46,21 @@ module MB
         # and impulse phase delay.
         attr_reader :delay
 
+        # The filter's latency is its processing delay, as the impulse delay is
+        # already part of its #response (see Filter#latency).
+        alias latency processing_delay
+
+        # Creates an FIR filter that convolves with the given time-domain
+        # +impulse+ response (a Numo::NArray), such as one measured using
+        # MB::Sound::ExponentialSweep.  The +:window_length+ and +:rate+ are
+        # passed to #initialize.
+        def self.from_impulse(impulse, window_length: nil, rate: 48000)
+          # Undo the normalization of real_fft so that the gains are the
+          # filter's actual frequency response
+          gains = MB::Sound.real_fft(impulse) * (impulse.length / 2.0)
+          new(gains, window_length: window_length, rate: rate, impulse: impulse)
+        end
+
         # Initializes an FIR filter with the given frequency +gains+.  The
         # +gains+ may either be a Hash mapping frequencies to gain values, or a
         # Numo::NArray with FFT-domain gain values starting from DC.
@@ -55,8 +70,9 @@ module MB
         # best performance), and sample +:rate+ may be overridden.
         #
         # The +:filter_length+ parameter is ignored if +gains+ is a
-        # Numo::NArray.
-        def initialize(gains, filter_length: nil, window_length: nil, rate: 48000)
+        # Numo::NArray.  The +:impulse+ parameter is for internal use by
+        # .from_impulse.
+        def initialize(gains, filter_length: nil, window_length: nil, rate: 48000, impulse: nil)
           @filter_length = filter_length
           @window_length = window_length
           @rate = rate
@@ -68,7 +84,7 @@ module MB
 
           when Numo::NArray
             @gain_map = nil
-            set_from_narray(gains)
+            set_from_narray(gains, impulse)
 
           else
             raise "Gains must be a Numo::NArray or a Hash mapping frequencies in Hz to linear gains (which may be complex)" unless gains.is_a?(Hash)
@@ -261,18 +277,27 @@ module MB
           set_from_narray(response)
         end
 
-        def set_from_narray(gains)
+        # Sets up convolution for the given +gains+.  If the time-domain
+        # +impulse+ is given, it is used as-is instead of being derived from
+        # the +gains+.
+        def set_from_narray(gains, impulse = nil)
           @gains = gains
-          @impulse = MB::Sound.real_ifft(gains)
 
-          # TODO: Do something about minimum phase, etc. so that impulse
-          # doesn't have energy at the end?  Will this rol actually do the
-          # wrong thing for some complex gain values?
-          #
-          # TODO: Allow using a window function to taper the ends of the
-          # impulse response and specifying a shorter filter length than the
-          # gains array or gain map would imply
-          @impulse = MB::M.rol(@impulse, @impulse.length / 2)
+          if impulse
+            @impulse = impulse
+          else
+            @impulse = MB::Sound.real_ifft(gains)
+
+            # TODO: Do something about minimum phase, etc. so that impulse
+            # doesn't have energy at the end?  Will this rol actually do the
+            # wrong thing for some complex gain values?
+            #
+            # TODO: Allow using a window function to taper the ends of the
+            # impulse response and specifying a shorter filter length than the
+            # gains array or gain map would imply
+            @impulse = MB::M.rol(@impulse, @impulse.length / 2)
+          end
+
           if @filter_length && @filter_length != @impulse.length
             puts "Specified filter length #{@filter_length} does not match impulse length #{@impulse.length}"
           end
@@ -287,8 +312,13 @@ module MB
           @filter_overlap = @filter_length - 1
           @filter_fft = MB::Sound.real_fft(MB::M.zpad(@impulse, @window_length))
 
-          # TODO: Understand why @filter_fft.length.to_f / @gains.length doesn't fully compensate for lost gain
-          @filter_fft.inplace * (@gains[1..-2].abs.mean / @filter_fft[1..-2].abs.mean) # Compensate for padding
+          if impulse
+            # Undo the normalization of real_fft to convolve with the impulse as given
+            @filter_fft.inplace * (@window_length / 2.0)
+          else
+            # TODO: Understand why @filter_fft.length.to_f / @gains.length doesn't fully compensate for lost gain
+            @filter_fft.inplace * (@gains[1..-2].abs.mean / @filter_fft[1..-2].abs.mean) # Compensate for padding
+          end
 
           @processing_delay = @window_length - @filter_overlap
           @impulse_delay = @impulse.abs.max_index
@@ -76,7 +76,8 @@ module MB
 
         # Processes the given array of samples, updating the state of the
         # follower along the way.  Returns the velocity-limited result.
-        # Supports in-place processing of NArray.
+        # Supports in-place processing of NArray.  Values smaller than
+        # DENORMAL_THRESHOLD are flushed to zero.
         def process(samples)
           samples.map { |s|
             s = s.abs if @absolute
@@ -91,6 +92,9 @@ module MB
             else
               @s = s
             end
+
+            @s = 0.0 if @s.abs < DENORMAL_THRESHOLD
+            @s
           }
         end
       end
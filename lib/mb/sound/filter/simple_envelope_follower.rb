@@ -23,11 +23,13 @@ module MB
         end
 
         # Processes the given array of samples, updating the state of the
-        # envelope along the way.  Supports in-place processing of NArray.
+        # envelope along the way.  Supports in-place processing of NArray.  The
+        # envelope is flushed to zero once it decays below DENORMAL_THRESHOLD.
         def process(samples)
           samples.map { |v|
             v = v.abs
-            @v = v > @v ? v : @v * @decay_per_sample
+            v = v > @v ? v : @v * @decay_per_sample
+            @v = v < DENORMAL_THRESHOLD ? 0.0 : v
           }
         end
       end
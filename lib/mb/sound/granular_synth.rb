@@ -0,0 +1,253 @@
+module MB
+  module Sound
+    # A granular synthesizer that plays many short, windowed, pitch-shifted
+    # excerpts (grains) of a source recording.  Grains are stored as a
+    # structure of arrays (one Numo::DFloat per field, see FIELDS) rather than
+    # as Ruby objects, and each output block is rendered for all active
+    # grains at once as a [grains, samples] array, so the cost is linear in
+    # the number of active grains with no per-grain or per-sample Ruby loops
+    # for in-memory sources.
+    #
+    # The source may be a 1D Numo::NArray or a MappedSample (mixed to mono).
+    # Grains from a MappedSample read only the frames they cover from the
+    # mapping, one read per grain per block.
+    #
+    # Example:
+    #     source = MB::Sound.read('sounds/synth0.flac')[0]
+    #     granular = MB::Sound::GranularSynth.new(source, window: MB::Sound::Window::Hann)
+    #     loop do
+    #       n = 40
+    #       granular.add_grains(
+    #         start: granular.time + Numo::DFloat.new(n).rand(0, 800),
+    #         offset: Numo::DFloat.new(n).rand(0, source.length - 48000),
+    #         length: 2400,
+    #         rate: 2 ** (Numo::DFloat.new(n).rand_norm(0, 0.1)),
+    #         pan: Numo::DFloat.new(n).rand(-1, 1),
+    #         gain: 0.05
+    #       )
+    #       output.write(granular.sample(800))
+    #     end
+    class GranularSynth
+      # The per-grain parameters, each stored in its own Numo::DFloat.
+      #
+      # start - The output sample time at which the grain begins (see #time).
+      # offset - The source frame at which the grain begins.
+      # length - The grain duration in output samples.
+      # rate - The number of source frames to advance per output sample.
+      # gain - The grain's peak amplitude.
+      # pan - The stereo position, from -1 (left) to 1 (right).
+      FIELDS = [:start, :offset, :length, :rate, :gain, :pan].freeze
+
+      # Default values for fields not given to #add_grains.
+      DEFAULTS = { rate: 1.0, gain: 1.0, pan: 0.0 }.freeze
+
+      # The maximum number of samples rendered in one pass, limiting the size
+      # of the temporary [grains, samples] arrays.
+      MAX_PASS = 256
+
+      # The number of output channels (1 or 2).
+      attr_reader :channels
+
+      # The output sample time of the next sample to be rendered.
+      attr_reader :time
+
+      # The maximum number of scheduled grains.
+      attr_reader :max_grains
+
+      # The number of grains dropped because #max_grains were already
+      # scheduled.
+      attr_reader :dropped
+
+      # The grain window, from 0 to 1, with one extra sample for
+      # interpolation.
+      attr_reader :window_table
+
+      # Initializes a granular synthesizer for the given +source+ (a 1D
+      # Numo::NArray or a MappedSample).
+      #
+      # +:window+ - A Window class or instance providing the grain envelope
+      #             shape (e.g. Window::Hann).
+      # +:table_size+ - The number of points in the window lookup table.
+      # +:channels+ - 1 for mono or 2 for stereo output.
+      # +:max_grains+ - The maximum number of grains scheduled at once.
+      def initialize(source, window: Window::Hann, table_size: 4096, channels: 2, max_grains: 4096)
+        raise 'Channels must be 1 or 2' unless [1, 2].include?(channels)
+        raise 'Max grains must be an int >= 1' unless max_grains.is_a?(Integer) && max_grains >= 1
+
+        if source.is_a?(MappedSample)
+          @mapped = source
+          @source_length = source.frames
+        else
+          @source = Numo::SFloat.cast(source)
+          raise 'Source must be one-dimensional' unless @source.ndim == 1
+          @source_length = @source.length
+        end
+
+        @channels = channels
+        @max_grains = max_grains
+        @time = 0
+        @count = 0
+        @dropped = 0
+
+        @grains = FIELDS.map { |f| [f, Numo::DFloat.zeros(max_grains)] }.to_h
+
+        window = window.new(table_size) if window.is_a?(Class)
+        table = Numo::DFloat.cast(window.pre_window || window.post_window)
+        @table_size = table.length
+        @window_table = Numo::DFloat.zeros(@table_size + 1)
+        @window_table[0...@table_size] = table / table.max
+        @window_table[-1] = @window_table[0]
+      end
+
+      # Returns the number of scheduled or playing grains.
+      def active_grains
+        @count
+      end
+
+      # Schedules grains described by the given fields (see FIELDS), each of
+      # which may be a Numo::NArray with one element per grain or a Numeric
+      # for all grains.  The +:start+, +:offset+, and +:length+ fields are
+      # required.  Grains beyond #max_grains are dropped.  Returns the number
+      # of grains added.
+      def add_grains(**fields)
+        missing = [:start, :offset, :length] - fields.keys
+        raise "Missing grain fields: #{missing.join(', ')}" unless missing.empty?
+        unknown = fields.keys - FIELDS
+        raise "Unknown grain fields: #{unknown.join(', ')}" unless unknown.empty?
+
+        fields = DEFAULTS.merge(fields)
+        count = fields.values.map { |v| v.respond_to?(:length) ? v.length : 1 }.max
+
+        added = [count, @max_grains - @count].min
+        @dropped += count - added
+        return 0 if added <= 0
+
+        range = @count...(@count + added)
+        FIELDS.each do |f|
+          v = fields[f]
+          @grains[f][range] = v.respond_to?(:length) && v.length > 1 ? v[0...added] : (v.respond_to?(:length) ? v[0] : v)
+        end
+        @count += added
+
+        added
+      end
+
+      # Removes all grains.
+      def clear
+        @count = 0
+      end
+
+      # Renders the next +count+ samples, returning an Array of Numo::SFloat
+      # with one element per channel, and removes grains that have finished.
+      def sample(count)
+        out = Numo::SFloat.zeros(@channels, count)
+
+        (0...count).step(MAX_PASS) do |offset|
+          n = [MAX_PASS, count - offset].min
+          render(out[true, offset...(offset + n)], n)
+          @time += n
+          remove_finished
+        end
+
+        @channels.times.map { |c| out[c, true] }
+      end
+
+      private
+
+      # Adds +n+ samples of all grains overlapping the current time to the
+      # [channels, n] +out+ view.
+      def render(out, n)
+        return if @count == 0
+
+        live = 0...@count
+        start = @grains[:start][live]
+        length = @grains[:length][live]
+        overlapping = ((start < @time + n) & (start + length > @time)).where
+        return if overlapping.empty?
+
+        g = overlapping.length
+        start = start[overlapping].reshape(g, 1)
+        length = length[overlapping].reshape(g, 1)
+        offset = @grains[:offset][overlapping].reshape(g, 1)
+        rate = @grains[:rate][overlapping].reshape(g, 1)
+
+        # Time since each grain started, for each output sample
+        t = Numo::DFloat.new(1, n).seq(@time) - start
+
+        # Window envelope, linearly interpolated from the table
+        w = (t * (@table_size / length)).clip(0, @table_size - 1e-6)
+        wi = Numo::Int64.cast(w)
+        lower = @window_table[wi].reshape(g, n)
+        env = (@window_table[wi + 1].reshape(g, n) - lower) * (w - wi)
+        env.inplace + lower
+
+        # Source position for each output sample
+        pos = t * rate
+        pos.inplace + offset
+        valid = (t >= 0) & (t < length) & (pos >= 0) & (pos < @source_length - 1)
+        pos = pos.not_inplace!.clip(0, [@source_length - 1.000001, 0].max)
+
+        value = gather(pos, g, n)
+        value.inplace * env.not_inplace!
+        value.not_inplace!
+        value[~valid] = 0
+
+        gain = @grains[:gain][overlapping]
+        if @channels == 1
+          out[0, true] += gain.dot(value)
+        else
+          angle = (@grains[:pan][overlapping].clip(-1, 1) + 1) * (Math::PI / 4)
+          out[0, true] += (gain * Numo::NMath.cos(angle)).dot(value)
+          out[1, true] += (gain * Numo::NMath.sin(angle)).dot(value)
+        end
+      end
+
+      # Returns the source linearly interpolated at each of the [g, n]
+      # positions +pos+.
+      def gather(pos, g, n)
+        index = Numo::Int64.cast(pos)
+        frac = pos - index
+
+        if @source
+          before = @source[index]
+          after = @source[index + 1]
+        else
+          # One read per grain covering its positions in this block
+          first = index.min(axis: 1).to_a
+          last = index.max(axis: 1).to_a
+          span = last.zip(first).map { |l, f| l - f }.max + 2
+          data = Numo::SFloat.zeros(g, span)
+          g.times do |i|
+            frames = @mapped.read_frames(first[i], [last[i] - first[i] + 2, span].min)
+            data[i, 0...frames.shape[0]] = frames.mean(axis: 1)
+          end
+
+          local = index - Numo::Int64.cast(first).reshape(g, 1)
+          local.inplace + Numo::Int64.new(g, 1).seq * span
+          before = data[local]
+          after = data[local.not_inplace! + 1]
+        end
+
+        value = Numo::DFloat.cast(after - before).reshape(g, n)
+        value.inplace * frac
+        value.inplace + before.reshape(g, n)
+        value.not_inplace!
+      end
+
+      # Removes grains that ended before the current time, preserving the
+      # order of the rest.
+      def remove_finished
+        return if @count == 0
+
+        live = 0...@count
+        keep = (@grains[:start][live] + @grains[:length][live] > @time).where
+        return if keep.length == @count
+
+        FIELDS.each do |f|
+          @grains[f][0...keep.length] = @grains[f][keep] if keep.length > 0
+        end
+        @count = keep.length
+      end
+    end
+  end
+end
@@ -154,6 +154,13 @@ module MB
         @jack ||= MB::Sound::JackFFI[].tap { |j| j.logger = Logger.new(STDOUT, level: Logger::ERROR) }
       end
 
+      # Returns a shared MB::Sound::JackNative client, used by #input and
+      # #output for the :jack_native input and output types.
+      def jack_native
+        @jack_native = nil if @jack_native&.closed?
+        @jack_native ||= MB::Sound::JackNative.new
+      end
+
       # Tries to auto-detect an input device for recording sound.  Returns a
       # sound input stream with a :read method.
       #
@@ -164,10 +171,10 @@ module MB
       # the default being 'system:capture_'.
       #
       # The input type may be changed using the INPUT_TYPE environment
-      # variable.  Supported input types are :jack_ffi, :jack, :alsa_pulse,
-      # :alsa, and :null.
+      # variable.  Supported input types are :jack_ffi, :jack_native, :jack,
+      # :alsa_pulse, :alsa, and :null.
       #
-      # See FFMPEGInput, mb-sound-jackffi, JackInput, and AlsaInput for more
+      # See FFMPEGInput, mb-sound-jackffi, JackNative, JackInput, and AlsaInput for more
       # flexible recording.
       def input(rate: 48000, channels: 2, device: nil, buffer_size: nil)
         input_type = detect_input
@@ -176,6 +183,9 @@ module MB
         when :jack_ffi
           jack.input(channels: channels, connect: device || :physical)
 
+        when :jack_native
+          jack_native.input(channels: channels, connect: device || :physical, buffer_size: buffer_size)
+
         when :jack
           MB::Sound::JackInput.new(ports: { device: device, count: channels }, buffer_size: buffer_size)
 
@@ -205,6 +215,8 @@ module MB
           if `pgrep jackd`.strip.length > 0
             if defined?(JackFFI)
               :jack_ffi
+            elsif MB::Sound::JackNative.available?
+              :jack_native
             else
               :jack
             end
@@ -229,10 +241,10 @@ module MB
       # the default being 'system:playback_'.
       #
       # The output type may be changed using the OUTPUT_TYPE environment
-      # variable.  Supported output types are :jack_ffi, :jack, :alsa_pulse,
-      # :alsa, and :null.
+      # variable.  Supported output types are :jack_ffi, :jack_native, :jack,
+      # :alsa_pulse, :alsa, and :null.
       #
-      # See FFMPEGOutput, mb-sound-jackffi, JackOutput, and AlsaOutput for more
+      # See FFMPEGOutput, mb-sound-jackffi, JackNative, JackOutput, and AlsaOutput for more
       # flexible playback.
       #
       # Pass either true or a Hash of options for MB::Sound::PlotOutput in
@@ -264,6 +276,9 @@ module MB
         when :jack_ffi
           o = jack.output(channels: channels, connect: device || :physical)
 
+        when :jack_native
+          o = jack_native.output(channels: channels, connect: device || :physical, buffer_size: buffer_size)
+
         when :jack
           o = MB::Sound::JackOutput.new(ports: { device: device, count: channels }, buffer_size: buffer_size)
 
@@ -296,6 +311,8 @@ module MB
           if `pgrep jackd`.strip.length > 0
             if defined?(JackFFI)
               :jack_ffi
+            elsif MB::Sound::JackNative.available?
+              :jack_native
             else
               :jack
             end
@@ -0,0 +1,393 @@
+begin
+  require 'ffi'
+rescue LoadError
+  # JackNative.available? will return false
+end
+
+module MB
+  module Sound
+    # A JACK client that calls libjack directly through the ffi gem, instead
+    # of piping through jack-stdin and jack-stdout like JackInput and
+    # JackOutput.  Audio moves between the JACK process callback and Ruby
+    # through one RingBuffer per direction, with one planar Numo::SFloat per
+    # port, so there is no extra process, pipe, or interleaving.
+    #
+    # The ffi gem and libjack must be installed (see .available?).  The
+    # process callback runs on JACK's realtime thread, which ffi hands to
+    # Ruby, so each callback only copies one period between the port buffers
+    # and the rings, using preallocated period buffers.  This is not a true
+    # lock-free realtime path: the callback must acquire Ruby's GVL, and the
+    # copies still allocate small Strings, so a busy Ruby thread or a garbage
+    # collection pause can cause xruns, especially with small JACK periods.
+    # Ring overruns, underruns, and JACK xruns are counted rather than
+    # raised.
+    #
+    # Example:
+    #     jack = MB::Sound::JackNative.new(name: 'mb-sound')
+    #     input = jack.input(channels: 2, connect: :physical)
+    #     output = jack.output(channels: 2, connect: :physical)
+    #     loop do
+    #       output.write(input.read(jack.buffer_size))
+    #     end
+    class JackNative
+      # The JACK port type for audio.
+      AUDIO_TYPE = '32 bit float mono audio'
+
+      # JackPortFlags
+      PORT_IS_INPUT = 0x1
+      PORT_IS_OUTPUT = 0x2
+      PORT_IS_PHYSICAL = 0x4
+
+      # JackOptions
+      NO_START_SERVER = 0x1
+
+      if defined?(::FFI)
+        # Bindings for the parts of libjack used by JackNative.
+        module Lib
+          extend ::FFI::Library
+
+          begin
+            ffi_lib ['jack', 'libjack.so.0']
+
+            callback :process_callback, [:uint32, :pointer], :int
+            callback :xrun_callback, [:pointer], :int
+
+            attach_function :jack_client_open, [:string, :int, :pointer, :varargs], :pointer
+            attach_function :jack_client_close, [:pointer], :int
+            attach_function :jack_get_client_name, [:pointer], :string
+            attach_function :jack_get_sample_rate, [:pointer], :uint32
+            attach_function :jack_get_buffer_size, [:pointer], :uint32
+            attach_function :jack_set_process_callback, [:pointer, :process_callback, :pointer], :int
+            attach_function :jack_set_xrun_callback, [:pointer, :xrun_callback, :pointer], :int
+            attach_function :jack_activate, [:pointer], :int
+            attach_function :jack_deactivate, [:pointer], :int
+            attach_function :jack_port_register, [:pointer, :string, :string, :ulong, :ulong], :pointer
+            attach_function :jack_port_unregister, [:pointer, :pointer], :int
+            attach_function :jack_port_get_buffer, [:pointer, :uint32], :pointer
+            attach_function :jack_port_name, [:pointer], :string
+            attach_function :jack_connect, [:pointer, :string, :string], :int
+            attach_function :jack_get_ports, [:pointer, :string, :string, :ulong], :pointer
+            attach_function :jack_free, [:pointer], :void
+
+            LOADED = true
+          rescue LoadError
+            LOADED = false
+          end
+        end
+      end
+
+      # Returns true if the ffi gem and libjack are available.
+      def self.available?
+        defined?(Lib) && Lib::LOADED || false
+      end
+
+      # The client name assigned by JACK.
+      attr_reader :name
+
+      # The JACK sample rate.
+      attr_reader :rate
+
+      # The JACK period size in frames.
+      attr_reader :buffer_size
+
+      # The number of xruns reported by JACK since the client was opened.
+      attr_reader :xruns
+
+      # The inputs and outputs created by #input and #output.
+      attr_reader :inputs, :outputs
+
+      # The first error raised within the process callback, if any.
+      attr_reader :error
+
+      # Opens a JACK client with the given +:name+.  The JACK server is not
+      # started if it is not running unless +:start_server+ is true.
+      def initialize(name: 'mb-sound', start_server: false)
+        raise 'The ffi gem and libjack are required for JackNative' unless self.class.available?
+
+        @client = Lib.jack_client_open(name, start_server ? 0 : NO_START_SERVER, nil)
+        raise "Unable to connect to the JACK server as #{name.inspect}" if @client.null?
+
+        @name = Lib.jack_get_client_name(@client)
+        @rate = Lib.jack_get_sample_rate(@client)
+        @buffer_size = Lib.jack_get_buffer_size(@client)
+        @xruns = 0
+        @inputs = []
+        @outputs = []
+        @port_count = 0
+
+        # Callbacks are kept in instance variables so they are not garbage
+        # collected while JACK holds them
+        @process_callback = method(:process)
+        @xrun_callback = ->(_arg) { @xruns += 1; 0 }
+        check(Lib.jack_set_process_callback(@client, @process_callback, nil), 'set the process callback')
+        check(Lib.jack_set_xrun_callback(@client, @xrun_callback, nil), 'set the xrun callback')
+        check(Lib.jack_activate(@client), 'activate the client')
+      end
+
+      # Creates an Input with +:channels+ new input ports, buffering up to
+      # +:buffer_size+ frames (at least two JACK periods).  If +:connect+ is
+      # :physical, the ports are connected to the system capture ports; if it
+      # is an Array of port names or a String prefix (e.g. 'system:capture_'),
+      # to those ports.
+      def input(channels: 2, connect: nil, buffer_size: nil)
+        ports = register_ports(channels, PORT_IS_INPUT)
+        input = Input.new(self, ports, ring_capacity(buffer_size))
+        connect_ports(ports, connect, PORT_IS_OUTPUT) { |theirs, ours| [theirs, ours] }
+
+        # Lists are replaced rather than modified, so the process callback
+        # never sees a list that is being changed
+        @inputs = @inputs + [input]
+        input
+      end
+
+      # Creates an Output with +:channels+ new output ports, buffering up to
+      # +:buffer_size+ frames (at least two JACK periods).  See #input for
+      # +:connect+.
+      def output(channels: 2, connect: nil, buffer_size: nil)
+        ports = register_ports(channels, PORT_IS_OUTPUT)
+        output = Output.new(self, ports, ring_capacity(buffer_size))
+        connect_ports(ports, connect, PORT_IS_INPUT) { |theirs, ours| [ours, theirs] }
+        @outputs = @outputs + [output]
+        output
+      end
+
+      # Removes the given Input or Output from the process callback and
+      # unregisters its ports.  Called by Stream#close.
+      def release(stream)
+        @inputs = @inputs - [stream]
+        @outputs = @outputs - [stream]
+        return if closed?
+
+        stream.ports.each do |port|
+          Lib.jack_port_unregister(@client, port)
+        end
+      end
+
+      # Returns the names of ports matching the given name regular expression
+      # and flags (e.g. PORT_IS_PHYSICAL | PORT_IS_OUTPUT for capture ports).
+      def ports(pattern: nil, flags: 0)
+        list = Lib.jack_get_ports(@client, pattern, AUDIO_TYPE, flags)
+        return [] if list.null?
+
+        names = list.get_array_of_string(0)
+        Lib.jack_free(list)
+        names
+      end
+
+      # Deactivates and closes the JACK client.
+      def close
+        return if closed?
+        Lib.jack_deactivate(@client)
+        Lib.jack_client_close(@client)
+        @client = nil
+      end
+
+      # Returns true if the client has been closed.
+      def closed?
+        @client.nil?
+      end
+
+      private
+
+      # The JACK process callback.  Copies one period from each input port to
+      # its ring, and from each output ring to its port.
+      def process(frames, _arg)
+        @inputs.each do |input|
+          input.receive(frames)
+        end
+
+        @outputs.each do |output|
+          output.send_period(frames)
+        end
+
+        0
+      rescue Exception => e
+        @error ||= e
+        0
+      end
+
+      # Returns the ring capacity for a stream that buffers +buffer_size+
+      # frames, which is never less than two JACK periods so that a small
+      # read size does not make every period overrun.
+      def ring_capacity(buffer_size)
+        [buffer_size || @buffer_size * 4, @buffer_size * 2].max
+      end
+
+      def register_ports(count, flags)
+        prefix = flags == PORT_IS_INPUT ? 'in' : 'out'
+        count.times.map {
+          @port_count += 1
+          port = Lib.jack_port_register(@client, "#{prefix}_#{@port_count}", AUDIO_TYPE, flags, 0)
+          raise "Unable to register JACK port #{prefix}_#{@port_count}" if port.null?
+          port
+        }
+      end
+
+      # Connects +ours+ to the ports described by +connect+, using the block
+      # to order each (theirs, ours) pair as (source, destination).
+      def connect_ports(ours, connect, their_flags)
+        theirs = case connect
+                 when nil
+                   []
+                 when :physical
+                   ports(flags: PORT_IS_PHYSICAL | their_flags)
+                 when String
+                   ours.length.times.map { |c| "#{connect}#{c + 1}" }
+                 when Array
+                   connect
+                 else
+                   raise "Invalid JACK connection: #{connect.inspect}"
+                 end
+
+        ours.zip(theirs).each do |port, other|
+          next if other.nil?
+          source, dest = yield other, Lib.jack_port_name(port)
+          Lib.jack_connect(@client, source, dest)
+        end
+      end
+
+      def check(result, action)
+        raise "Unable to #{action} (JACK error #{result})" unless result == 0
+      end
+
+      # Common functionality of JACK inputs and outputs.
+      class Stream
+        # The JACK client.
+        attr_reader :jack
+
+        # The FFI pointers to this stream's JACK ports.
+        attr_reader :ports
+
+        # The RingBuffer between the process callback and Ruby.
+        attr_reader :ring
+
+        def initialize(jack, ports, capacity)
+          @jack = jack
+          @ports = ports
+          @ring = RingBuffer.new(channels: ports.length, capacity: capacity)
+          @closed = false
+          @period = ports.map { Numo::SFloat.zeros(jack.buffer_size) }
+        end
+
+        # The number of channels (ports).
+        def channels
+          @ports.length
+        end
+
+        # The JACK sample rate.
+        def rate
+          @jack.rate
+        end
+
+        # The JACK period size.
+        def buffer_size
+          @jack.buffer_size
+        end
+
+        # Stops transferring audio for this stream and unregisters its JACK
+        # ports.
+        def close
+          return if @closed
+          @closed = true
+          @jack.release(self)
+        end
+
+        # Returns true if the stream has been closed.
+        def closed?
+          @closed
+        end
+
+        private
+
+        # Returns the preallocated period buffers, reallocated only if the
+        # JACK period size changes.
+        def period(frames)
+          @period = @ports.map { Numo::SFloat.zeros(frames) } if @period[0].length != frames
+          @period
+        end
+
+        # Sleeps for about a quarter of a JACK period while waiting for the
+        # process callback.
+        def wait
+          raise IOError, 'The JACK client is closed' if @jack.closed?
+          raise @jack.error if @jack.error
+          Kernel.sleep(@jack.buffer_size.to_f / (@jack.rate * 4))
+        end
+      end
+
+      # A set of JACK input ports, read like any other input stream.
+      class Input < Stream
+        # The number of frames JACK delivered while the ring was full.
+        attr_reader :overruns
+
+        def initialize(*)
+          super
+          @overruns = 0
+        end
+
+        # Waits for +frames+ frames to arrive from JACK, then returns an Array
+        # of Numo::SFloat with one element per port.
+        def read(frames)
+          raise IOError, 'Input is closed' if closed?
+
+          frames = [frames, @ring.capacity].min
+          wait until @ring.available >= frames
+          @ring.read(frames)
+        end
+
+        # Called by the process callback to store a period from each port.
+        def receive(frames)
+          return if closed?
+
+          data = period(frames)
+          @ports.each_with_index do |port, idx|
+            data[idx].store_binary(Lib.jack_port_get_buffer(port, frames).get_bytes(0, frames * 4))
+          end
+
+          @overruns += frames - @ring.write(data)
+        end
+      end
+
+      # A set of JACK output ports, written like any other output stream.
+      class Output < Stream
+        # The number of frames JACK requested while the ring was empty.
+        attr_reader :underruns
+
+        def initialize(*)
+          super
+          @underruns = 0
+        end
+
+        # Writes the given Array of Numo::NArrays (one per port), waiting for
+        # room in the ring as needed.
+        def write(data)
+          raise IOError, 'Output is closed' if closed?
+          raise ArgumentError, "Received #{data.length} channels when #{channels} were expected" if data.length != channels
+
+          offset = 0
+          while offset < data[0].length
+            written = @ring.write(offset == 0 ? data : data.map { |c| c[offset..-1] })
+            wait if written == 0
+            offset += written
+          end
+        end
+
+        # Called by the process callback to fill a period of each port, with
+        # silence for any frames not yet written.
+        def send_period(frames)
+          return if closed?
+
+          out = period(frames)
+          data = @ring.read(frames, out: out)
+          got = data.empty? ? 0 : data[0].length
+          @underruns += frames - got
+
+          @ports.each_with_index do |port, idx|
+            out[idx][got...frames] = 0 if got < frames
+            Lib.jack_port_get_buffer(port, frames).put_bytes(0, out[idx].to_binary)
+          end
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,288 @@
+require 'etc'
+require 'fiddle'
+require 'tmpdir'
+
+module MB
+  module Sound
+    # A complex FFT of a signal too large to transform in memory.  The data is
+    # kept in a scratch file of Numo::DComplex values that is memory mapped
+    # (falling back to IO#pread and IO#pwrite), and transformed with the
+    # four-step algorithm: the length is factored into +rows+ * +columns+,
+    # the columns are transformed and multiplied by twiddle factors, the rows
+    # are transformed, and the result is transposed into a second scratch file
+    # so bins are in their natural order.  Only a block of rows or columns is
+    # in memory at a time, limited by the +:memory+ given to the constructor.
+    #
+    # Each pass is divided among +:workers+ forked processes, which write
+    # their blocks directly to the shared scratch files.
+    #
+    # Unlike FFTMethods#fft, transforms are not scaled, except that #inverse!
+    # divides by the length so that it undoes #forward!.
+    #
+    # Example:
+    #     fft = MB::Sound::LargeFFT.new(data.length)
+    #     fft.write(0, data)
+    #     fft.forward!
+    #     fft.read(0, 100) # => the first 100 bins
+    #     fft.close
+    class LargeFFT
+      # The default number of bytes of sample data to process at a time.
+      DEFAULT_MEMORY = 256 * 1024 * 1024
+
+      # Bytes per Numo::DComplex element.
+      ELEMENT_SIZE = 16
+
+      # Each block may exist in up to this many copies while being processed.
+      BLOCK_COPIES = 4
+
+      PROT_READ = 1
+      PROT_WRITE = 2
+      MAP_SHARED = 1
+
+      # Returns the number of rows (the largest factor of +length+ no greater
+      # than its square root) and columns of the four-step FFT.
+      def self.factor(length)
+        rows = Integer.sqrt(length)
+        rows -= 1 until length % rows == 0
+        [rows, length / rows]
+      end
+
+      # Returns the smallest length no less than +length+ whose rows and
+      # columns (see .factor) fit in +memory+ bytes.  Signals may be
+      # zero-padded to this length when the original length has no factor near
+      # its square root (e.g. a prime length).
+      def self.good_length(length, memory = DEFAULT_MEMORY)
+        length += 1 until factor(length)[1] * ELEMENT_SIZE * BLOCK_COPIES <= memory
+        length
+      end
+
+      # The transform length.
+      attr_reader :length
+
+      # The number of rows and columns the length is factored into.
+      attr_reader :rows, :columns
+
+      # The number of elements to read or write at a time to stay within the
+      # memory limit.
+      attr_reader :block_size
+
+      # The number of processes used for each pass.
+      attr_reader :workers
+
+      # Initializes zero-filled scratch files in +:dir+ for a transform of
+      # +length+ complex values.  Raises an error if the length cannot be
+      # factored to fit in +:memory+ bytes (see .good_length).
+      def initialize(length, dir: Dir.tmpdir, memory: DEFAULT_MEMORY, workers: Etc.nprocessors)
+        raise 'Length must be an int >= 1' unless length.is_a?(Integer) && length >= 1
+        raise 'Workers must be an int >= 1' unless workers.is_a?(Integer) && workers >= 1
+
+        @length = length
+        @rows, @columns = self.class.factor(length)
+        @workers = workers
+
+        if @columns * ELEMENT_SIZE * BLOCK_COPIES > memory
+          raise "Length #{length} has no factor near its square root to fit in #{memory} bytes; pad to #{self.class.good_length(length, memory)}"
+        end
+
+        @block_size = memory / (ELEMENT_SIZE * BLOCK_COPIES)
+        @data = Scratch.new(dir, length * ELEMENT_SIZE)
+        @spare = Scratch.new(dir, length * ELEMENT_SIZE)
+      end
+
+      # Writes +data+ (any numeric Numo::NArray) starting at element +offset+.
+      def write(offset, data)
+        raise 'Data would extend past the end of the transform' if offset < 0 || offset + data.length > @length
+        @data.write(offset * ELEMENT_SIZE, Numo::DComplex.cast(data).to_binary)
+      end
+
+      # Returns +count+ elements starting at +offset+ as a Numo::DComplex.
+      def read(offset, count)
+        raise 'Range extends past the end of the transform' if offset < 0 || offset + count > @length
+        Numo::DComplex.from_binary(@data.read(offset * ELEMENT_SIZE, count * ELEMENT_SIZE))
+      end
+
+      # Replaces the contents with their forward DFT.
+      def forward!
+        transform(false)
+      end
+
+      # Replaces the contents with their inverse DFT.
+      def inverse!
+        transform(true)
+      end
+
+      # Replaces the bins above Nyquist with the complex conjugates of the
+      # matching bins below Nyquist, and discards the imaginary part of the DC
+      # and Nyquist bins, so that the inverse transform is real (as with
+      # Numo::Pocketfft.irfft).
+      def make_hermitian!
+        ((@length / 2 + 1)...@length).step(@block_size) do |k|
+          count = [@block_size, @length - k].min
+          write(k, read(@length - k - count + 1, count).reverse.conj)
+        end
+
+        write(0, read(0, 1).real)
+        write(@length / 2, read(@length / 2, 1).real) if @length.even?
+      end
+
+      # Deletes the scratch files.
+      def close
+        @data&.close
+        @spare&.close
+        @data = nil
+        @spare = nil
+      end
+
+      private
+
+      # Four-step FFT of the scratch data, leaving the result in natural order.
+      def transform(inverse)
+        column_pass(inverse)
+        row_pass(inverse)
+        transpose_pass
+
+        @data, @spare = @spare, @data
+      end
+
+      # The number of columns per block in the column and transpose passes.
+      def column_block
+        [@block_size / @rows, 1].max
+      end
+
+      # Transforms each column (stride +columns+), then multiplies by the
+      # twiddle factors.
+      def column_pass(inverse)
+        sign = inverse ? 2.0 : -2.0
+
+        parallel((0...@columns).step(column_block).to_a) do |c0|
+          w = [column_block, @columns - c0].min
+
+          t = read_columns(c0, w).transpose.dup
+          t = inverse ? Numo::Pocketfft.ifft(t) : Numo::Pocketfft.fft(t)
+
+          # Twiddle factors for columns c0...(c0 + w) and output rows, with
+          # the exponent reduced modulo the length for precision
+          m = (Numo::Int64.new(w, 1).seq(c0) * Numo::Int64.new(1, @rows).seq) % @length
+          angle = Numo::DFloat.cast(m) * (sign * Math::PI / @length)
+          t.inplace * (Numo::NMath.cos(angle) + Numo::NMath.sin(angle) * Complex::I)
+
+          write_columns(c0, t.not_inplace!.transpose.dup)
+        end
+      end
+
+      # Transforms each row in place.
+      def row_pass(inverse)
+        h = [@block_size / @columns, 1].max
+
+        parallel((0...@rows).step(h).to_a) do |r0|
+          count = [h, @rows - r0].min
+          offset = r0 * @columns * ELEMENT_SIZE
+          bytes = count * @columns * ELEMENT_SIZE
+
+          block = Numo::DComplex.from_binary(@data.read(offset, bytes), [count, @columns])
+          block = inverse ? Numo::Pocketfft.ifft(block) : Numo::Pocketfft.fft(block)
+          @data.write(offset, block.to_binary)
+        end
+      end
+
+      # Transposes the [rows, columns] data into the [columns, rows] spare
+      # file, which puts the bins in natural order.
+      def transpose_pass
+        parallel((0...@columns).step(column_block).to_a) do |c0|
+          w = [column_block, @columns - c0].min
+          @spare.write(c0 * @rows * ELEMENT_SIZE, read_columns(c0, w).transpose.dup.to_binary)
+        end
+      end
+
+      # Returns a [rows, w] Numo::DComplex of columns c0...(c0 + w).
+      def read_columns(c0, w)
+        block = Numo::DComplex.zeros(@rows, w)
+        @rows.times do |r|
+          block[r, true] = Numo::DComplex.from_binary(@data.read((r * @columns + c0) * ELEMENT_SIZE, w * ELEMENT_SIZE))
+        end
+        block
+      end
+
+      # Writes a [rows, w] Numo::DComplex to columns c0...(c0 + w).
+      def write_columns(c0, block)
+        @rows.times do |r|
+          @data.write((r * @columns + c0) * ELEMENT_SIZE, block[r, true].to_binary)
+        end
+      end
+
+      # Calls the block for each job, divided among forked worker processes if
+      # possible.
+      def parallel(jobs, &block)
+        if @workers <= 1 || jobs.length <= 1 || !Process.respond_to?(:fork)
+          jobs.each(&block)
+          return
+        end
+
+        pids = jobs.each_slice((jobs.length.to_f / @workers).ceil).map { |slice|
+          Process.fork do
+            begin
+              slice.each(&block)
+              exit!(0)
+            rescue Exception => e
+              STDERR.puts "LargeFFT worker failed: #{e}"
+              exit!(1)
+            end
+          end
+        }
+
+        failed = pids.map { |pid| Process.wait2(pid)[1] }.reject(&:success?)
+        raise "#{failed.length} LargeFFT workers failed" unless failed.empty?
+      end
+
+      # A zero-filled temporary file that is memory mapped for reading and
+      # writing if possible, and deleted when closed.  The mapping is shared,
+      # so writes from forked workers are visible to the parent.
+      class Scratch
+        def initialize(dir, bytes)
+          @file = File.open(File.join(dir, "mb-sound-fft-#{Process.pid}-#{object_id}.bin"), File::RDWR | File::CREAT | File::EXCL | File::BINARY)
+          @file.truncate(bytes)
+          @map = map_file(bytes)
+        end
+
+        # Reads +bytes+ bytes from +offset+.
+        def read(offset, bytes)
+          @map ? @map[offset, bytes] : @file.pread(bytes, offset)
+        end
+
+        # Writes the String +data+ at +offset+.
+        def write(offset, data)
+          if @map
+            @map[offset, data.bytesize] = data
+          else
+            @file.pwrite(data, offset)
+          end
+        end
+
+        # Unmaps, closes, and deletes the file.
+        def close
+          if @map
+            MappedSample.munmap.call(@map, @map.size)
+            @map = nil
+          end
+
+          path = @file.path
+          @file.close
+          File.unlink(path) if File.exist?(path)
+        end
+
+        private
+
+        def map_file(bytes)
+          mmap = MappedSample.mmap
+          return nil if mmap.nil? || bytes == 0
+
+          ptr = mmap.call(nil, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, @file.fileno, 0)
+          return nil if ptr.null? || ptr.to_i == -1 || ptr.to_i == 2 ** (Fiddle::SIZEOF_VOIDP * 8) - 1
+
+          ptr.size = bytes
+          ptr
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,208 @@
+require 'fiddle'
+require 'fileutils'
+require 'digest'
+require 'tmpdir'
+
+module MB
+  module Sound
+    # Sample data stored as raw interleaved 32-bit floats in a file that is
+    # memory mapped instead of read, so opening even a large sample library
+    # is instant and only the pages that are actually played occupy RAM.
+    # Files are converted once from anything FFMPEGInput can read (see
+    # .convert and .cached).
+    #
+    # Where mmap is not available through Fiddle, data is read with IO#pread
+    # instead, which still only reads the requested ranges.
+    #
+    # Example:
+    #     piano = MB::Sound::MappedSample.cached('sounds/piano_c4.flac')
+    #     piano.read(48000, 800) # => [Numo::SFloat(800), Numo::SFloat(800)]
+    class MappedSample
+      # Identifies the file format.
+      MAGIC = 'MBSF'
+
+      # The header holds MAGIC, a version, channels, rate, and frame count,
+      # padded so sample data is well aligned.
+      HEADER_SIZE = 64
+      HEADER_FORMAT = 'a4L<L<L<Q<'
+      VERSION = 1
+
+      # The default location for files converted by .cached.
+      DEFAULT_CACHE_DIR = File.join(Dir.tmpdir, 'mb-sound-samples')
+
+      # The number of frames converted at a time.
+      CONVERT_SIZE = 65536
+
+      PROT_READ = 1
+      MAP_SHARED = 1
+
+      # Converts +source+ (a filename, which is decoded by FFMPEG and resampled
+      # to +:rate+, or an input stream) to a raw sample file at +path+.  The
+      # file is written to a temporary name and renamed, so a partially
+      # converted file is never opened.  Returns +path+.
+      def self.convert(source, path, rate: 48000)
+        input = source.is_a?(String) ? MB::Sound.file_input(source, resample: rate) : source
+        rate = input.rate if input.respond_to?(:rate)
+
+        tmp = "#{path}.#{Process.pid}.tmp"
+        FileUtils.mkdir_p(File.dirname(path))
+
+        File.open(tmp, 'wb') do |f|
+          f.write("\0" * HEADER_SIZE)
+          frames = 0
+
+          loop do
+            data = input.read(CONVERT_SIZE)
+            break if data.nil? || data[0].length == 0
+
+            interleaved = Numo::SFloat.zeros(data[0].length, input.channels)
+            data.each_with_index do |c, idx|
+              interleaved[true, idx] = c
+            end
+
+            f.write(interleaved.to_binary)
+            frames += data[0].length
+          end
+
+          f.seek(0)
+          f.write([MAGIC, VERSION, input.channels, rate.round, frames].pack(HEADER_FORMAT))
+        end
+
+        File.rename(tmp, path)
+        path
+
+      ensure
+        input.close if source.is_a?(String) && input.respond_to?(:close)
+        File.unlink(tmp) if tmp && File.exist?(tmp)
+      end
+
+      # Opens the converted copy of the given audio +filename+ in
+      # +:cache_dir+, converting it first if it is missing or older than the
+      # original file.
+      def self.cached(filename, cache_dir: DEFAULT_CACHE_DIR, rate: 48000)
+        key = Digest::SHA256.hexdigest("#{File.expand_path(filename)}:#{rate}")
+        path = File.join(cache_dir, "#{File.basename(filename)}.#{key[0...16]}.f32")
+
+        convert(filename, path, rate: rate) unless File.exist?(path) && File.mtime(path) >= File.mtime(filename)
+
+        new(path)
+      end
+
+      # The filename of the raw sample file.
+      attr_reader :path
+
+      # The number of channels.
+      attr_reader :channels
+
+      # The sample rate in Hz.
+      attr_reader :rate
+
+      # The number of sample frames.
+      attr_reader :frames
+
+      # Opens and maps a raw sample file written by .convert.
+      def initialize(path)
+        @path = path
+        @file = File.open(path, 'rb')
+
+        magic, version, @channels, @rate, @frames = @file.read(HEADER_SIZE).to_s.unpack(HEADER_FORMAT)
+        raise "#{path} is not a raw sample file" unless magic == MAGIC
+        raise "Unsupported raw sample file version #{version}" unless version == VERSION
+        raise "#{path} is truncated" if @file.size < HEADER_SIZE + @frames * @channels * 4
+
+        @frame_bytes = @channels * 4
+        @map = map_file
+      end
+
+      # Returns true if the file is memory mapped (false if using IO#pread).
+      def mapped?
+        !@map.nil?
+      end
+
+      # Returns +count+ frames starting at frame +start+ as a [count, channels]
+      # Numo::SFloat.  Frames outside the sample are zero.
+      def read_frames(start, count)
+        out = Numo::SFloat.zeros(count, @channels)
+
+        first = start.clamp(0, @frames)
+        last = (start + count).clamp(0, @frames)
+        return out if last <= first
+
+        offset = HEADER_SIZE + first * @frame_bytes
+        length = (last - first) * @frame_bytes
+        bytes = @map ? @map[offset, length] : @file.pread(length, offset)
+        out[(first - start)...(last - start), true] = Numo::SFloat.from_binary(bytes, [last - first, @channels])
+
+        out
+      end
+
+      # Returns +count+ frames starting at frame +start+ as an Array of
+      # Numo::SFloat, one per channel.
+      def read(start, count)
+        data = read_frames(start, count)
+        @channels.times.map { |c| data[true, c].dup }
+      end
+
+      # Returns the duration in seconds.
+      def duration
+        @frames.to_f / @rate
+      end
+
+      # Unmaps and closes the file.
+      def close
+        if @map
+          self.class.munmap.call(@map, @map.size)
+          @map = nil
+        end
+        @file.close unless @file.closed?
+      end
+
+      private
+
+      # Maps the whole file read-only, returning a Fiddle::Pointer, or nil if
+      # mmap is unavailable.
+      def map_file
+        funcs = self.class.mmap
+        return nil if funcs.nil? || @file.size == 0
+
+        ptr = funcs.call(nil, @file.size, PROT_READ, MAP_SHARED, @file.fileno, 0)
+        return nil if ptr.null? || ptr.to_i == -1 || ptr.to_i == 2 ** (Fiddle::SIZEOF_VOIDP * 8) - 1
+
+        ptr.size = @file.size
+        ptr
+      end
+
+      class << self
+        # Returns a Fiddle::Function for mmap, or nil if unavailable.
+        def mmap
+          load_libc
+          @mmap
+        end
+
+        # Returns a Fiddle::Function for munmap, or nil if unavailable.
+        def munmap
+          load_libc
+          @munmap
+        end
+
+        private
+
+        def load_libc
+          return if @libc_loaded
+          @libc_loaded = true
+
+          libc = Fiddle.dlopen(nil)
+          @mmap = Fiddle::Function.new(
+            libc['mmap'],
+            [Fiddle::TYPE_VOIDP, Fiddle::TYPE_SIZE_T, Fiddle::TYPE_INT, Fiddle::TYPE_INT, Fiddle::TYPE_INT, Fiddle::TYPE_LONG],
+            Fiddle::TYPE_VOIDP
+          )
+          @munmap = Fiddle::Function.new(libc['munmap'], [Fiddle::TYPE_VOIDP, Fiddle::TYPE_SIZE_T], Fiddle::TYPE_INT)
+        rescue Fiddle::DLError
+          @mmap = nil
+          @munmap = nil
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,99 @@
+module MB
+  module Sound
+    # An output stream that encodes the same audio to several files at once
+    # (e.g. FLAC, MP3, and Opus) with a single ffmpeg process.  The raw audio
+    # is piped to ffmpeg once and mapped to each output, instead of being
+    # piped to one FFMPEGOutput per file (as with MultiWriter).
+    #
+    # Example:
+    #     output = MB::Sound::MultiFormatOutput.new(
+    #       [
+    #         'tmp/mix.flac',
+    #         ['tmp/mix.mp3', 'libmp3lame', '192k'],
+    #         { filename: 'tmp/mix.opus', codec: 'libopus', bitrate: '128k' },
+    #       ],
+    #       rate: 48000,
+    #       channels: 2
+    #     )
+    #     output.write([left, right])
+    #     output.close
+    class MultiFormatOutput < IOOutput
+      # The output targets, each a Hash with :filename, :codec, :bitrate, and
+      # :format keys.
+      attr_reader :targets
+
+      # Starts an ffmpeg process to write audio to every target in +targets+.
+      # Each target may be a filename, an Array of [filename, codec,
+      # bitrate], or a Hash with :filename and optional :codec, :bitrate, and
+      # :format keys (see FFMPEGOutput#initialize for their meanings).
+      def initialize(targets, rate:, channels:, loglevel: nil, buffer_size: nil)
+        raise 'At least one target is required' if targets.nil? || targets.empty?
+        raise "Sample rate must be a positive Integer" unless rate.is_a?(Integer) && rate > 0
+        raise "Channels must be a positive Integer" unless channels.is_a?(Integer) && channels > 0
+
+        @targets = targets.map { |t| normalize_target(t) }
+
+        super(
+          [
+            'ffmpeg',
+            '-nostdin',
+            '-y',
+            '-loglevel', loglevel || '8',
+            '-ar', rate.to_s,
+            '-ac', channels.to_s,
+            '-f', 'f32le',
+            '-i', 'pipe:',
+            *@targets.flat_map { |t|
+              [
+                '-map', '0:a',
+                *(t[:format] ? ['-f', t[:format].to_s] : []),
+                *(t[:codec] ? ['-acodec', t[:codec].to_s] : []),
+                *(t[:bitrate] ? ['-b:a', t[:bitrate].to_s] : []),
+                t[:filename]
+              ]
+            }
+          ],
+          channels,
+          buffer_size || 32768,
+          rate: rate
+        )
+      end
+
+      # The output filenames, in the order given to the constructor.
+      def filenames
+        @targets.map { |t| t[:filename] }
+      end
+
+      private
+
+      # Converts a target given to the constructor into a Hash, expanding its
+      # filename and checking that its directory is writable (unless the
+      # target has a :format override).
+      def normalize_target(target)
+        target = case target
+                 when String
+                   { filename: target }
+                 when Array
+                   { filename: target[0], codec: target[1], bitrate: target[2] }
+                 when Hash
+                   target.dup
+                 else
+                   raise ArgumentError, "Invalid output target: #{target.inspect}"
+                 end
+
+        raise ArgumentError, "Output target #{target.inspect} has no filename" unless target[:filename]
+
+        # As with FFMPEGOutput, a :format override may name a virtual or
+        # device output, so its filename is passed to ffmpeg as given
+        unless target[:format]
+          dirname = File.expand_path(File.dirname(target[:filename]))
+          raise "#{dirname.inspect} isn't a directory" unless File.directory?(dirname)
+          raise "Directory #{dirname.inspect} isn't writable" unless File.writable?(dirname)
+          target[:filename] = File.join(dirname, File.basename(target[:filename]))
+        end
+
+        target
+      end
+    end
+  end
+end
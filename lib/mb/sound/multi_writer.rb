@@ -2,17 +2,56 @@ module MB
   module Sound
     # Writes audio to multiple output streams.  All output streams must accept
     # the same buffer size.  If some streams support fewer channels
+    #
+    # By default each stream is written in turn, so one slow stream delays
+    # the others.  In concurrent mode, streams are written by their own
+    # threads from bounded queues, with a per-stream policy for a full queue
+    # (see POLICIES), so e.g. a realtime output written with :sync is never
+    # held up by a slow encoder or plot.
+    #
+    # Example:
+    #     multi = MB::Sound::MultiWriter.new(
+    #       [MB::Sound.output, MB::Sound.file_output('/tmp/rec.flac', channels: 2), plot_output],
+    #       concurrent: true,
+    #       policy: [:sync, :grow, :drop]
+    #     )
+    #     multi.write(data)
+    #     multi.stats # => per-stream queue lag, drops, etc.
+    #     multi.close
     class MultiWriter
       class SampleRateMismatch < ArgumentError; end
       class BufferSizeMismatch < ArgumentError; end
       class ChannelCountMismatch < ArgumentError; end
 
+      # Policies for writing to each stream in concurrent mode:
+      #
+      # :sync - Written by the calling thread, as in non-concurrent mode.
+      # :block - Queued, and #write waits if the queue is full.
+      # :drop - Queued, and the buffer is dropped for this stream if the queue
+      #         is full.
+      # :grow - Queued with no limit on the queue length.
+      POLICIES = [:sync, :block, :drop, :grow].freeze
+
+      # Queue state for one stream in concurrent mode.
+      Sink = Struct.new(:stream, :policy, :queue, :thread, :written, :dropped, :max_queued, :error, keyword_init: true)
+
+      # Tells a writer thread to exit.
+      STOP = Object.new.freeze
+
       attr_reader :rate, :buffer_size, :channels
 
+      # The maximum number of buffers queued for a :block or :drop stream.
+      attr_reader :queue_size
+
       # Initializes a multiple-output writer with the given Array of output
       # streams.  All output streams must have the same buffer size and sample
       # rate.
-      def initialize(streams)
+      #
+      # If +:concurrent+ is true, each stream is written according to its
+      # +:policy+ (a Symbol from POLICIES for all streams, or an Array with
+      # one per stream), queueing up to +:queue_size+ buffers.  Call #close to
+      # finish writing queued audio and stop the writer threads.
+      def initialize(streams, concurrent: false, policy: :block, queue_size: 4)
         raise 'All output streams must respond to :write' unless streams.all? { |s| s.respond_to?(:write) }
         @streams = streams
 
@@ -27,16 +66,147 @@ module MB
         end
 
         @channels = streams.map(&:channels).max
+
+        @queue_size = queue_size
+        @closed = false
+        start_threads(policy) if concurrent
+      end
+
+      # Returns true if writing to streams in background threads.
+      def concurrent?
+        !@sinks.nil?
       end
 
       # Writes the given +data+ to all of the output streams that were given to
       # the constructor.  There must be enough channels provided to match the
       # channel count of the output stream with the most channels.
+      #
+      # In concurrent mode, data for queued streams is copied, so the caller
+      # may reuse its buffers.  Errors raised by a writer thread are raised by
+      # the next call to #write.
       def write(data)
         raise ChannelCountMismatch, "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+        raise IOError, 'MultiWriter is closed' if @closed
+
+        if @sinks.nil?
+          @streams.each do |s|
+            s.write(data[0...s.channels])
+          end
+          return
+        end
+
+        @sinks.each do |sink|
+          raise sink.error if sink.error
+          next unless sink.policy == :sync
+
+          sink.stream.write(data[0...sink.stream.channels])
+          sink.written += 1
+        end
+
+        @sinks.each do |sink|
+          next if sink.policy == :sync
+
+          if sink.policy == :drop && sink.queue.length >= @queue_size
+            sink.dropped += 1
+            next
+          end
+
+          sink.queue.push(data[0...sink.stream.channels].map(&:dup))
+          sink.max_queued = sink.queue.length if sink.queue.length > sink.max_queued
+        end
+      end
+
+      # Returns an Array with a Hash of statistics for each stream in
+      # concurrent mode, or nil otherwise:
+      #
+      # :policy - The stream's policy (see POLICIES).
+      # :queued - The number of buffers waiting to be written.
+      # :lag - The duration of the waiting buffers in seconds.
+      # :max_queued - The largest number of buffers that have been waiting.
+      # :written - The number of buffers written to the stream.
+      # :dropped - The number of buffers dropped by the :drop policy.
+      def stats
+        @sinks&.map { |sink|
+          queued = sink.queue&.length || 0
+          {
+            policy: sink.policy,
+            queued: queued,
+            lag: queued * @buffer_size.to_f / @rate,
+            max_queued: sink.max_queued,
+            written: sink.written,
+            dropped: sink.dropped,
+          }
+        }
+      end
+
+      # Waits for queued audio to be written and stops the writer threads.
+      # The output streams are not closed.  Raises the first error from a
+      # writer thread, if any.
+      def close
+        return if @closed
+        @closed = true
+        return if @sinks.nil?
+
+        @sinks.each do |sink|
+          next unless sink.queue
+          sink.queue.push(STOP)
+          sink.thread.join
+        end
+
+        error = @sinks.map(&:error).compact.first
+        raise error if error
+      end
+
+      # Returns true if #close has been called.
+      def closed?
+        @closed
+      end
+
+      private
+
+      # Creates the queues and writer threads for concurrent mode.
+      def start_threads(policy)
+        policies = policy.is_a?(Array) ? policy : [policy] * @streams.length
+        raise ArgumentError, "Expected #{@streams.length} policies, got #{policies.length}" unless policies.length == @streams.length
+        invalid = policies - POLICIES
+        raise ArgumentError, "Invalid policies #{invalid}; expected one of #{POLICIES}" unless invalid.empty?
+
+        @sinks = @streams.each_with_index.map { |stream, idx|
+          sink = Sink.new(stream: stream, policy: policies[idx], written: 0, dropped: 0, max_queued: 0)
+
+          case sink.policy
+          when :block
+            sink.queue = SizedQueue.new(@queue_size)
+          when :drop, :grow
+            sink.queue = Queue.new
+          end
+
+          if sink.queue
+            sink.thread = Thread.new do
+              Thread.current.name = "MultiWriter #{idx}"
+              Thread.current.report_on_exception = false
+              write_queue(sink)
+            end
+          end
+
+          sink
+        }
+      end
+
+      # Writes buffers from the +sink+'s queue to its stream until stopped.
+      # After an error the queue is still emptied so #write never blocks.
+      def write_queue(sink)
+        loop do
+          data = sink.queue.pop
+          break if data.equal?(STOP)
+          next if sink.error
 
-        @streams.each do |s|
-          s.write(data[0...s.channels])
+          begin
+            sink.stream.write(data)
+            sink.written += 1
+          rescue => e
+            sink.error = e
+          end
         end
       end
     end
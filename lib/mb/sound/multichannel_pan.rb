@@ -0,0 +1,159 @@
+module MB
+  module Sound
+    # Pans any number of mono sources to a ring of speakers, like
+    # two-dimensional VBAP: each source is panned between the two speakers
+    # on either side of its azimuth, using the same gain law as ComplexPan
+    # (constant power by default).  All sources are mixed to all speakers in
+    # one call with matrix products, so hundreds of sources can be panned per
+    # buffer without Ruby loops over sources or samples.
+    #
+    # Azimuths are in radians, counterclockwise from straight ahead, so
+    # positive angles are to the left (e.g. 30.degrees is front left).
+    #
+    # When source azimuths change between buffers, gains ramp linearly across
+    # the buffer to avoid clicks.  Azimuths may also be automated per sample
+    # by passing a [sources, samples] Numo::NArray.
+    #
+    # Example:
+    #     # 5.0 speaker layout: L, R, C, Ls, Rs
+    #     pan = MB::Sound::MultichannelPan.new(speakers: [30, -30, 0, 110, -110].map(&:degrees))
+    #     sources = Numo::SFloat.new(200, 800).rand(-0.01, 0.01)
+    #     angles = Numo::DFloat.new(200).rand(-Math::PI, Math::PI)
+    #     output.write(pan.process(sources, angles))
+    class MultichannelPan
+      TWO_PI = 2.0 * Math::PI
+
+      # The speaker azimuths in radians, in output channel order.
+      attr_reader :speakers
+
+      # The exponent of the pairwise gain curve (see ComplexPan).
+      attr_reader :pan_power
+
+      # Initializes a panner for the given speaker azimuths in radians (see
+      # the class description).  The +:center_gain+ is the gain of each
+      # speaker when a source is halfway between two speakers (see
+      # ComplexPan::DB_3 and friends).
+      def initialize(speakers:, center_gain: ComplexPan::DB_3)
+        raise 'At least two speakers are required' unless speakers.length >= 2
+
+        @speakers = speakers.map(&:to_f).freeze
+
+        angles = @speakers.map { |a| a % TWO_PI }
+        raise 'Speakers must have different azimuths' if angles.uniq.length != angles.length
+
+        order = angles.each_index.sort_by { |i| angles[i] }
+        @order = Numo::Int64.cast(order)
+        @sorted = Numo::DFloat.cast(order.map { |i| angles[i] })
+
+        self.center_gain = center_gain
+        @previous = nil
+      end
+
+      # The number of speakers (output channels).
+      def channels
+        @speakers.length
+      end
+
+      # Changes the gain when a source is halfway between two speakers.
+      def center_gain=(center_gain)
+        @center_gain = center_gain
+        @pan_power = Math.log(@center_gain) / Math.log(0.5)
+      end
+
+      # Returns a Numo::DFloat of speaker gains for the given source
+      # +azimuths+ (a Numeric, Array, or Numo::NArray of any shape), with the
+      # speaker index as the first dimension followed by the shape of
+      # +azimuths+.
+      def gains(azimuths)
+        azimuths = Numo::DFloat.cast(azimuths)
+        shape = azimuths.shape
+        a = wrap(azimuths.flatten)
+        m = a.length
+        s = @sorted.length
+
+        # The last speaker at or before each source, wrapping around to the
+        # last speaker for sources before the first
+        lower = Numo::Int64.cast((@sorted.reshape(1, s) <= a.reshape(m, 1)).count_true(axis: 1)) - 1
+        lower[lower < 0] = s - 1
+        upper = (lower + 1) % s
+
+        start = @sorted[lower]
+        arc = wrap(@sorted[upper] - start)
+        t = wrap(a - start) / arc
+
+        g = Numo::DFloat.zeros(s, m)
+        columns = Numo::Int64.new(m).seq
+        g[@order[lower] * m + columns] = (1.0 - t) ** @pan_power
+        g[@order[upper] * m + columns] = t ** @pan_power
+
+        g.reshape(s, *shape)
+      end
+
+      # Pans and mixes +sources+ (a [sources, samples] Numo::NArray, an
+      # Array of 1D Numo::NArrays, or a single 1D Numo::NArray) to every
+      # speaker.  The +azimuths+ may be a Numeric, one value per source, or a
+      # [sources, samples] Numo::NArray for per-sample automation.  Returns
+      # an Array with one Numo::NArray per speaker.
+      def process(sources, azimuths)
+        x = source_matrix(sources)
+        m, n = x.shape
+
+        azimuths = Numo::DFloat.new(m).fill(azimuths) if azimuths.is_a?(Numeric)
+        azimuths = Numo::DFloat.cast(azimuths)
+
+        if azimuths.ndim == 2
+          raise ArgumentError, "Azimuth shape #{azimuths.shape} does not match sources #{x.shape}" unless azimuths.shape == [m, n]
+
+          g = gains(azimuths)
+          out = (g * x.reshape(1, m, n)).sum(axis: 1)
+          @previous = nil
+        else
+          raise ArgumentError, "Expected #{m} azimuths, got #{azimuths.length}" unless azimuths.length == m
+
+          g = gains(azimuths)
+          if @previous && @previous.shape == g.shape && @previous != g
+            # Linear ramp from the previous gains to the new gains:
+            # sum(((1 - r) * g0 + r * g1) * x) = g0.x + (g1 - g0).(r * x)
+            ramp = Numo::DFloat.new(1, n).seq(1) / n
+            out = @previous.dot(x) + (g - @previous).dot(x * ramp)
+          else
+            out = g.dot(x)
+          end
+          @previous = g
+        end
+
+        out = x.class.cast(out) unless out.class == x.class
+        channels.times.map { |c| out[c, true] }
+      end
+
+      # Forgets the previous gains so the next buffer does not ramp from them.
+      def reset
+        @previous = nil
+      end
+
+      private
+
+      # Wraps angles in a Numo::DFloat to the range 0...TWO_PI.
+      def wrap(a)
+        a - (a / TWO_PI).floor * TWO_PI
+      end
+
+      # Returns +sources+ as a 2D [sources, samples] Numo::NArray.
+      def source_matrix(sources)
+        if sources.is_a?(Array)
+          type = sources[0].class
+          type = Numo::SFloat unless type < Numo::NArray
+          x = type.zeros(sources.length, sources[0].length)
+          sources.each_with_index do |c, idx|
+            x[idx, true] = c
+          end
+          x
+        elsif sources.ndim == 1
+          sources.reshape(1, sources.length)
+        else
+          sources
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,262 @@
+module MB
+  module Sound
+    # A spectral noise reducer for use in a WindowMethods#process_window block
+    # (or anywhere else there are DFTs of overlapping windows).  It learns the
+    # average noise power in each frequency bin, then attenuates each bin of
+    # later frames according to its estimated signal-to-noise ratio.
+    #
+    # All channels of a frame are handled together as a [channels, bins]
+    # array, and the gain calculation, temporal smoothing, and frequency
+    # smoothing are whole-array operations on state allocated for the first
+    # frame, so there are no per-bin Ruby loops.
+    #
+    # Example:
+    #     nr = MB::Sound::NoiseReduction.new(learn_frames: 20)
+    #     MB::Sound.process_window(input, output, MB::Sound::Window::Hann.new(2048)) do |dfts|
+    #       nr.process(dfts)
+    #     end
+    #
+    #     # Or learn from a separate recording of just the noise
+    #     nr = MB::Sound::NoiseReduction.new(mode: :subtraction, learn_frames: 0)
+    #     nr.learn_from('sounds/room_tone.flac', MB::Sound::Window::Hann.new(2048))
+    class NoiseReduction
+      # Supported gain calculation modes.
+      MODES = [:wiener, :subtraction].freeze
+
+      # The gain calculation mode (see MODES).
+      attr_reader :mode
+
+      # The multiplier applied to the noise estimate before calculating gains.
+      # Values above 1 remove more noise at the expense of more artifacts.
+      attr_accessor :strength
+
+      # The minimum gain applied to any bin (e.g. 0.1 for -20dB).
+      attr_accessor :floor
+
+      # The fraction of the previous frame's gain retained in each new frame,
+      # from 0 (no temporal smoothing) to less than 1.
+      attr_accessor :time_smoothing
+
+      # The number of bins on either side of each bin averaged into its gain.
+      attr_reader :freq_smoothing
+
+      # The number of frames to learn from at the start of processing.
+      attr_reader :learn_frames
+
+      # The number of frames in the noise profile.
+      attr_reader :learned_frames
+
+      # Initializes a noise reducer.
+      #
+      # +:mode+ - :wiener for Wiener filter gains, or :subtraction for power
+      #           spectral subtraction.
+      # +:learn_frames+ - The number of frames at the start of processing to
+      #                   treat as noise.  These frames are attenuated by the
+      #                   +:floor+ gain.  Use 0 when calling #learn_from.
+      # +:strength+ - Over-subtraction factor (see #strength).
+      # +:floor+ - The minimum gain (see #floor).
+      # +:time_smoothing+ - Gain smoothing over time (see #time_smoothing).
+      # +:freq_smoothing+ - Gain smoothing radius in bins (see
+      #                     #freq_smoothing).
+      def initialize(mode: :wiener, learn_frames: 10, strength: 1.0, floor: 0.1, time_smoothing: 0.5, freq_smoothing: 2)
+        raise "Mode must be one of #{MODES}" unless MODES.include?(mode)
+        raise 'Learn frames must be an int >= 0' unless learn_frames.is_a?(Integer) && learn_frames >= 0
+        raise 'Time smoothing must be between 0 and 1' unless time_smoothing >= 0 && time_smoothing < 1
+        raise 'Frequency smoothing must be an int >= 0' unless freq_smoothing.is_a?(Integer) && freq_smoothing >= 0
+
+        @mode = mode
+        @learn_frames = learn_frames
+        @strength = strength
+        @floor = floor
+        @time_smoothing = time_smoothing
+        @freq_smoothing = freq_smoothing
+
+        @learned_frames = 0
+        @auto_frames = 0
+        @channels = nil
+        @bins = nil
+      end
+
+      # Returns the learned noise power of each bin as a [channels, bins]
+      # Numo::DFloat, or nil if nothing has been learned.
+      def noise_profile
+        return nil if @learned_frames == 0
+        @noise_sum / @learned_frames
+      end
+
+      # Replaces the noise profile with the given [channels, bins] power
+      # spectrum (e.g. from another NoiseReduction's #noise_profile).
+      def noise_profile=(profile)
+        profile = Numo::DFloat.cast(profile)
+        raise 'Noise profile must be a 2D [channels, bins] array' unless profile.ndim == 2
+
+        allocate(*profile.shape)
+        @noise_sum[] = profile
+        @learned_frames = 1
+      end
+
+      # Discards the learned noise profile, so the next #learn_frames frames
+      # will be learned again.
+      def reset
+        @learned_frames = 0
+        @auto_frames = 0
+        @noise_sum&.fill(0)
+        @gain&.fill(1)
+        self
+      end
+
+      # Adds one frame of DFTs (an Array of Numo::DComplex, one per channel, or
+      # a [channels, bins] Numo::DComplex) to the noise profile.
+      def learn(dfts)
+        spectrum = frame_power(dfts)
+        @noise_sum.inplace + spectrum
+        @noise_sum.not_inplace!
+        @learned_frames += 1
+        self
+      end
+
+      # Learns a noise profile from all of the given +input+ (a filename, an
+      # input stream, or anything accepted by ArrayInput), analyzed with the
+      # same +window+ that will be used for processing.
+      def learn_from(input, window, pad_factor: 1)
+        input = MB::Sound.file_input(input) if input.is_a?(String)
+        input = ArrayInput.new(input) unless input.respond_to?(:read)
+
+        MB::Sound.analyze_window(input, window, pad_factor: pad_factor) do |dfts|
+          learn(dfts)
+          nil
+        end
+
+        self
+      end
+
+      # Attenuates the noise in one frame of DFTs (an Array of Numo::DComplex,
+      # one per channel, or a [channels, bins] Numo::DComplex), modifying and
+      # returning them.  The first #learn_frames frames processed are added to
+      # the noise profile.  Frames are returned unmodified if there is no
+      # noise profile.
+      def process(dfts)
+        if @auto_frames < @learn_frames
+          @auto_frames += 1
+          learn(dfts)
+          @gain.fill(@floor)
+          return apply_gain(dfts)
+        end
+
+        return dfts if @learned_frames == 0
+
+        calculate_gain(frame_power(dfts))
+        apply_gain(dfts)
+      end
+
+      # Returns a Proc that calls #process, so a NoiseReduction can be passed
+      # directly as the block to WindowMethods#process_window.
+      def to_proc
+        method(:process).to_proc
+      end
+
+      private
+
+      # Allocates state for the given frame size, or raises an error if the
+      # frame size changed.
+      def allocate(channels, bins)
+        if @channels
+          return if channels == @channels && bins == @bins
+          raise "Frame size changed from #{@channels}x#{@bins} to #{channels}x#{bins}"
+        end
+
+        @channels = channels
+        @bins = bins
+
+        @spectrum = Numo::DComplex.zeros(channels, bins)
+        @power = Numo::DFloat.zeros(channels, bins)
+        @noise_sum = Numo::DFloat.zeros(channels, bins)
+        @gain = Numo::DFloat.ones(channels, bins)
+        @new_gain = Numo::DFloat.zeros(channels, bins)
+        @padded = Numo::DFloat.zeros(channels, bins + 2 * @freq_smoothing + 1)
+      end
+
+      # Copies the frame into the [channels, bins] spectrum and returns the
+      # power of each bin.
+      def frame_power(dfts)
+        if dfts.is_a?(Numo::NArray)
+          allocate(*dfts.shape)
+          @spectrum[] = dfts
+        else
+          allocate(dfts.length, dfts[0].length)
+          dfts.each_with_index do |c, idx|
+            @spectrum[idx, true] = c
+          end
+        end
+
+        @power[] = @spectrum.abs
+        @power.inplace ** 2
+        @power.not_inplace!
+      end
+
+      # Calculates the smoothed gain of each bin from its +power+ and the noise
+      # profile.
+      def calculate_gain(power)
+        # Ratio of noise to signal power
+        g = @new_gain
+        g[] = @noise_sum
+        g.inplace * (@strength / @learned_frames)
+        g.inplace / (power + 1e-30)
+
+        case @mode
+        when :wiener
+          # Wiener gain from the estimated a priori SNR: snr / (1 + snr), with
+          # snr = P / N - 1, simplifies to 1 - N / P.
+          g.inplace * -1
+          g.inplace + 1
+
+        when :subtraction
+          # Magnitude gain after subtracting noise power
+          g.inplace * -1
+          g.inplace + 1
+          g[] = g.not_inplace!.clip(0, 1)
+          g.inplace ** 0.5
+        end
+
+        g[] = g.not_inplace!.clip(0, 1)
+
+        smooth_frequency(g) if @freq_smoothing > 0
+
+        # Temporal smoothing
+        @gain.inplace * @time_smoothing
+        @gain.inplace + g * (1 - @time_smoothing)
+        @gain[] = @gain.not_inplace!.clip(@floor, 1)
+      end
+
+      # Replaces each bin of +g+ with the mean of the bins within
+      # #freq_smoothing of it, repeating the edge bins to fill the ends.
+      def smooth_frequency(g)
+        r = @freq_smoothing
+        @padded[true, 0] = 0
+        @padded[true, 1..r] = g[true, 0...1]
+        @padded[true, (r + 1)...(r + 1 + @bins)] = g
+        @padded[true, (r + 1 + @bins)..-1] = g[true, -1..-1]
+
+        # Moving average as a difference of cumulative sums
+        sums = @padded.cumsum(axis: 1)
+        g[] = sums[true, (2 * r + 1)..-1]
+        g.inplace - sums[true, 0...@bins]
+        g.inplace / (2 * r + 1)
+        g.not_inplace!
+      end
+
+      # Multiplies the DFTs by the current gains.
+      def apply_gain(dfts)
+        if dfts.is_a?(Numo::NArray)
+          dfts.inplace * @gain
+          dfts.not_inplace!
+        else
+          dfts.each_with_index do |c, idx|
+            c.inplace * @gain[idx, true]
+            c.not_inplace!
+          end
+        end
+      end
+    end
+  end
+end
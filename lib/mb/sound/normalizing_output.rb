@@ -0,0 +1,119 @@
+require 'tempfile'
+
+module MB
+  module Sound
+    # An output stream wrapper that normalizes audio of unknown length without
+    # keeping it in memory.  Everything written is spooled to a temporary file
+    # of raw 32-bit floats while the peak is tracked, then when the stream is
+    # closed the spooled audio is copied to the wrapped output, scaled the same
+    # way as GainMethods#normalize_max.
+    #
+    # Example:
+    #     output = MB::Sound::NormalizingOutput.new(MB::Sound.file_output('/tmp/out.flac', channels: 2))
+    #     output.write([left, right])
+    #     output.close # writes /tmp/out.flac
+    class NormalizingOutput
+      # The number of frames copied to the wrapped output at a time.
+      COPY_SIZE = 65536
+
+      # The wrapped output stream.
+      attr_reader :output
+
+      # The maximum absolute sample value after normalization.
+      attr_reader :limit
+
+      # The largest absolute sample value written so far.
+      attr_reader :peak
+
+      # The number of frames written so far.
+      attr_reader :frames_written
+
+      # Initializes a normalizing wrapper around the given +output+ stream,
+      # which must respond to :write, :channels, and :close.  If +:louder+ is
+      # true, quiet audio is made louder as well (see
+      # GainMethods#normalize_max).
+      def initialize(output, limit: 1.0, louder: false)
+        @output = output
+        @limit = limit
+        @louder = louder
+        @channels = output.channels
+        @peak = 0.0
+        @frames_written = 0
+        @spool = Tempfile.new(['mb-sound-normalize', '.f32'], binmode: true)
+      end
+
+      # The number of channels of the wrapped output.
+      def channels
+        @channels
+      end
+
+      # The sample rate of the wrapped output, if it has one.
+      def rate
+        @output.rate if @output.respond_to?(:rate)
+      end
+
+      # The buffer size of the wrapped output, if it has one.
+      def buffer_size
+        @output.buffer_size if @output.respond_to?(:buffer_size)
+      end
+
+      # Spools the given Array of Numo::NArrays (one per channel) to be
+      # written when the stream is closed.  Returns the number of frames.
+      def write(data)
+        raise IOError, 'Output is closed' if closed?
+        raise ArgumentError, "Received #{data.length} channels when #{@channels} were expected" if data.length != @channels
+
+        frames = data[0].length
+        return 0 if frames == 0
+
+        interleaved = Numo::SFloat.zeros(frames, @channels)
+        data.each_with_index do |c, idx|
+          interleaved[true, idx] = c
+        end
+
+        @peak = [@peak, interleaved.abs.max].max
+        @spool.write(interleaved.to_binary)
+        @frames_written += frames
+
+        frames
+      end
+
+      # Returns the gain that will be applied when the stream is closed.
+      def gain
+        return 1.0 if @peak <= @limit && !@louder
+        return 1.0 if @peak == 0
+
+        mult = @limit / @peak
+        mult = (1 - @louder) + @louder * mult if @peak < @limit && @louder.is_a?(Numeric)
+        mult
+      end
+
+      # Returns true if the stream has been closed.
+      def closed?
+        @spool.nil?
+      end
+
+      # Writes the spooled audio to the wrapped output, scaled by #gain, then
+      # closes the wrapped output and deletes the spool file.
+      def close
+        return if closed?
+
+        mult = gain
+        frame_bytes = @channels * 4
+        @spool.rewind
+
+        while (bytes = @spool.read(COPY_SIZE * frame_bytes))
+          data = Numo::SFloat.from_binary(bytes, [bytes.bytesize / frame_bytes, @channels])
+          data.inplace * mult unless mult == 1
+          data = data.not_inplace!
+          @output.write(@channels.times.map { |c| data[true, c] })
+        end
+
+        @output.close
+      ensure
+        @spool&.close!
+        @spool = nil
+      end
+    end
+  end
+end
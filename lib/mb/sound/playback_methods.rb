@@ -30,16 +30,8 @@ module MB
           data = data * 2 if data.length < 2
           channels = data.length
 
-          # TODO: if this code needs to be modified much in the future, come up
-          # with a shared way of chunking data that can work for all play and
-          # plot methods
           output = MB::Sound.output(rate: rate, channels: channels, plot: plot, device: device)
-          buffer_size = output.buffer_size
-          (0...data[0].length).step(buffer_size).each do |offset|
-            output.write(data.map { |c|
-              MB::M.zpad(c[offset...([offset + buffer_size, c.length].min)], buffer_size)
-            })
-          end
+          write_chunks(output, data, gain: gain)
 
         when Tone
           output = MB::Sound.output(rate: rate, plot: plot, device: device)
@@ -63,16 +55,22 @@ module MB
         output = MB::Sound.output(channels: channels || (input.channels < 2 ? 2 : input.channels), plot: plot, device: device)
 
         buffer_size = output.buffer_size
+        padded = []
 
         # TODO: Move all playback loops to a processing helper method when those are added
         loop do
           data = input.read(buffer_size)
           break if data.nil? || data.empty? || data[0].empty?
 
-          # Apply gain and pad the final input chunk to the output buffer size
-          data = data.map { |d|
-            MB::M.zpad(d.inplace * gain, buffer_size).not_inplace!
-          }
+          # Apply gain in place, and pad the final input chunk to the output
+          # buffer size in a reused buffer
+          unless gain == 1
+            data.each do |d|
+              d.inplace * gain
+              d.not_inplace!
+            end
+          end
+          data = pad_chunk(data, buffer_size, padded) if data[0].length < buffer_size
 
           # Ensure the output is at least stereo (Pulseaudio plays nothing for
           # mono output on my system)
@@ -84,6 +82,61 @@ module MB
       ensure
         input&.close
       end
+
+      # Writes the Array of channels in +data+ to +output+ in chunks of the
+      # output's buffer size.  Full chunks are written as views into +data+,
+      # or scaled into reused scratch buffers if +:gain+ is not 1, and the
+      # final partial chunk is zero-padded into the scratch buffers, so no
+      # sample data is allocated per chunk.
+      def write_chunks(output, data, gain: 1.0)
+        buffer_size = output.buffer_size
+        length = data[0].length
+        chunk = Array.new(data.length)
+        scratch = []
+
+        (0...length).step(buffer_size) do |offset|
+          count = [buffer_size, length - offset].min
+
+          data.each_with_index do |c, idx|
+            chunk[idx] = c[offset...(offset + count)]
+          end
+
+          if count < buffer_size
+            pad_chunk(chunk, buffer_size, scratch).each_with_index do |c, idx|
+              chunk[idx] = c
+            end
+          elsif gain != 1
+            chunk.each_with_index do |c, idx|
+              scratch[idx] ||= Numo::SFloat.zeros(buffer_size)
+              scratch[idx][] = c
+              chunk[idx] = scratch[idx]
+            end
+          end
+
+          unless gain == 1
+            chunk.each do |c|
+              c.inplace * gain
+              c.not_inplace!
+            end
+          end
+
+          output.write(chunk)
+        end
+      end
+
+      # Copies each channel of +data+ into the start of a zeroed buffer of
+      # +buffer_size+ samples from +buffers+ (an Array that is filled with
+      # buffers as needed, for reuse in later calls).  Returns an Array of the
+      # padded buffers.
+      def pad_chunk(data, buffer_size, buffers)
+        data.each_with_index.map { |c, idx|
+          b = buffers[idx]
+          b = buffers[idx] = Numo::SFloat.zeros(buffer_size) if b.nil? || b.length != buffer_size
+          b[0...c.length] = c
+          b[c.length..-1] = 0 if c.length < buffer_size
+          b
+        }
+      end
     end
   end
 end
@@ -0,0 +1,264 @@
+require 'set'
+
+module MB
+  module Sound
+    # Records an input stream (e.g. from AlsaInput or JackInput) to a series
+    # of files for as long as it runs, starting a new file every
+    # +:segment_seconds+ or when a file reaches +:segment_bytes+.  Segment
+    # boundaries are sample-continuous: every frame captured is written to
+    # exactly one file, in order.
+    #
+    # Capture never waits for encoding.  A capture thread copies from the
+    # input into a preallocated RingBuffer, a writer thread copies from the
+    # ring to the current segment's output, and finished segments are closed
+    # (which waits for the encoder to finish) by a pool of +:encoders+
+    # threads while the next segment is already being written.  If the ring
+    # fills up because an encoder stalls, the frames that do not fit are
+    # counted in #dropped_frames.
+    #
+    # Example:
+    #     recorder = MB::Sound::Recorder.new(
+    #       MB::Sound.input(channels: 2),
+    #       'recordings/capture-%Y%m%d-%H%M%S.flac',
+    #       segment_seconds: 3600
+    #     )
+    #     recorder.start
+    #     sleep
+    class Recorder
+      # The input stream being recorded.
+      attr_reader :input
+
+      # The RingBuffer between the capture and writer threads.
+      attr_reader :ring
+
+      # The number of frames per segment, if rotating by duration.
+      attr_reader :segment_frames
+
+      # The approximate file size in bytes at which to start a new segment,
+      # if rotating by size.
+      attr_reader :segment_bytes
+
+      # The total number of frames read from the input.
+      attr_reader :frames_captured
+
+      # The total number of frames written to segment outputs.
+      attr_reader :frames_written
+
+      # The number of frames discarded because the ring was full.
+      attr_reader :dropped_frames
+
+      # The filename of the segment currently being written, if any.
+      attr_reader :current_filename
+
+      # Errors raised by the input, outputs, or encoders.
+      attr_reader :errors
+
+      # Initializes a recorder for the given +input+ stream, writing segments
+      # to filenames made by passing +pattern+ through Time#strftime for the
+      # segment's start time, after replacing '%{index}' with the zero-padded
+      # segment number.  If that gives the same name as an earlier segment
+      # (e.g. two segments starting within the same second), the segment
+      # number is added before the extension so no segment is overwritten.
+      #
+      # +:segment_seconds+ - The duration of each file (nil for no limit).
+      # +:segment_bytes+ - The approximate size of each file, checked as the
+      #                    file grows, so files may be slightly larger (nil
+      #                    for no limit).
+      # +:ring_seconds+ - How much audio may be buffered in memory while
+      #                   waiting for a slow encoder.
+      # +:encoders+ - The number of threads that finish segment encoding.
+      # +:output+ - A Proc called with a filename, +:channels+, and +:rate+
+      #             that returns an output stream (FFMPEGOutput by default).
+      def initialize(input, pattern, segment_seconds: 3600, segment_bytes: nil, ring_seconds: 10, encoders: 2, output: nil)
+        raise 'Input must respond to :read' unless input.respond_to?(:read)
+        raise 'Encoders must be an int >= 1' unless encoders.is_a?(Integer) && encoders >= 1
+
+        @input = input
+        @pattern = pattern
+        @rate = input.respond_to?(:rate) && input.rate || 48000
+        @channels = input.channels
+        @buffer_size = input.respond_to?(:buffer_size) && input.buffer_size || 800
+
+        @segment_frames = segment_seconds && (segment_seconds * @rate).round
+        @segment_bytes = segment_bytes
+        raise 'Segment length must be at least one frame' if @segment_frames && @segment_frames < 1
+
+        @ring = RingBuffer.new(channels: @channels, capacity: [(ring_seconds * @rate).round, @buffer_size].max)
+        @output = output || ->(filename, channels:, rate:) {
+          MB::Sound.file_output(filename, channels: channels, rate: rate, overwrite: true)
+        }
+
+        @encoder_count = encoders
+        @frames_captured = 0
+        @frames_written = 0
+        @dropped_frames = 0
+        @segment_index = 0
+        @segments = {}
+        @filenames = Set.new
+        @errors = []
+        @mutex = Mutex.new
+      end
+
+      # Starts the capture, writer, and encoder threads.
+      def start
+        raise 'Recorder is already running' if running?
+
+        @stop = false
+        @capture_done = false
+        @encode_queue = Queue.new
+        @encoders = @encoder_count.times.map { Thread.new { encode_loop } }
+        @writer = Thread.new { write_loop }
+        @capture = Thread.new { capture_loop }
+
+        self
+      end
+
+      # Returns true if the capture thread is running.
+      def running?
+        @capture&.alive? || false
+      end
+
+      # Returns the filenames of segments that have been closed, in order.
+      def segments
+        @mutex.synchronize { @segments.sort.map(&:last) }
+      end
+
+      # Stops capturing, writes everything already captured, and waits for
+      # all segments to be encoded.  Returns the list of segment filenames.
+      def stop
+        return segments if @writer.nil?
+
+        @stop = true
+        @capture.join
+        @writer.join
+        @encoders.length.times { @encode_queue.push(nil) }
+        @encoders.each(&:join)
+
+        @capture = nil
+        @writer = nil
+        @encoders = nil
+
+        segments
+      end
+
+      # Waits for the input to end (e.g. for a file or ArrayInput), then
+      # stops the recorder.
+      def wait
+        @capture&.join
+        stop
+      end
+
+      private
+
+      # Copies from the input to the ring until stopped or the input ends.
+      def capture_loop
+        Thread.current.name = 'Recorder capture'
+
+        until @stop
+          data = @input.read(@buffer_size)
+          break if data.nil? || data.empty? || data[0].length == 0
+
+          written = @ring.write(data)
+          @frames_captured += data[0].length
+          @dropped_frames += data[0].length - written
+        end
+      rescue => e
+        add_error(e)
+      ensure
+        @capture_done = true
+      end
+
+      # Copies from the ring to segment outputs, starting new segments at
+      # exact frame boundaries.
+      def write_loop
+        Thread.current.name = 'Recorder writer'
+        output = nil
+
+        loop do
+          # Checked before the ring so data written just before capture ends
+          # is not missed
+          done = @capture_done
+          if @ring.empty?
+            break if done
+            Kernel.sleep(@buffer_size.to_f / (@rate * 2))
+            next
+          end
+
+          data = @ring.read(@buffer_size)
+          offset = 0
+
+          while offset < data[0].length
+            output ||= open_segment
+            count = data[0].length - offset
+            count = [count, @segment_frames - @written_in_segment].min if @segment_frames
+
+            output.write(offset == 0 && count == data[0].length ? data : data.map { |c| c[offset...(offset + count)] })
+            offset += count
+            @written_in_segment += count
+            @frames_written += count
+
+            if segment_full?
+              finish_segment(output)
+              output = nil
+            end
+          end
+        end
+
+        finish_segment(output) if output
+      rescue => e
+        add_error(e)
+        finish_segment(output) if output
+      end
+
+      # Opens the next segment's output.
+      def open_segment
+        index = @segment_index
+        @segment_index += 1
+        @written_in_segment = 0
+
+        number = index.to_s.rjust(4, '0')
+        filename = Time.now.strftime(@pattern.gsub('%{index}', number))
+        if @filenames.include?(filename)
+          ext = File.extname(filename)
+          filename = "#{filename.chomp(ext)}-#{number}#{ext}"
+        end
+        @filenames << filename
+
+        @current_filename = filename
+        @output.call(@current_filename, channels: @channels, rate: @rate)
+      end
+
+      # Returns true if the current segment has reached its duration or size.
+      def segment_full?
+        return true if @segment_frames && @written_in_segment >= @segment_frames
+        return true if @segment_bytes && (File.size?(@current_filename) || 0) >= @segment_bytes
+        false
+      end
+
+      # Hands the given output to the encoder pool to be closed.
+      def finish_segment(output)
+        @encode_queue.push([output, @segment_index - 1, @current_filename])
+        @current_filename = nil
+      end
+
+      # Closes segment outputs until given nil.
+      def encode_loop
+        Thread.current.name = 'Recorder encoder'
+
+        while (job = @encode_queue.pop)
+          output, index, filename = job
+          begin
+            output.close
+            @mutex.synchronize { @segments[index] = filename }
+          rescue => e
+            add_error(e)
+          end
+        end
+      end
+
+      def add_error(e)
+        @mutex.synchronize { @errors << e }
+      end
+    end
+  end
+end
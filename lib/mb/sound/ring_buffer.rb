@@ -0,0 +1,148 @@
+module MB
+  module Sound
+    # A preallocated, planar, multichannel ring buffer of audio samples, for
+    # passing audio from exactly one producer to exactly one consumer (e.g.
+    # from a capture thread to a processing thread).
+    #
+    # The producer only ever modifies the write counter, and the consumer only
+    # ever modifies the read counter, so no Mutex is needed as long as there is
+    # only one of each.  The counters increase forever, and positions within
+    # the buffer are derived from them, so a full buffer can be told apart from
+    # an empty one without wasting a slot.
+    #
+    # Example:
+    #     ring = MB::Sound::RingBuffer.new(channels: 2, capacity: 4800)
+    #     ring.write([Numo::SFloat[1, 2, 3], Numo::SFloat[4, 5, 6]])
+    #     ring.read(2)
+    #     # => [Numo::SFloat[1, 2], Numo::SFloat[4, 5]]
+    class RingBuffer
+      # The number of channels of audio stored in the buffer.
+      attr_reader :channels
+
+      # The maximum number of frames the buffer can hold.
+      attr_reader :capacity
+
+      # The total number of frames ever read from the buffer.
+      attr_reader :read_count
+
+      # The total number of frames ever written to the buffer.
+      attr_reader :write_count
+
+      # Initializes a ring buffer holding up to +:capacity+ frames of
+      # +:channels+ channels, using the given Numo::NArray +:type+ for storage.
+      def initialize(channels:, capacity:, type: Numo::SFloat)
+        raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+        raise 'Capacity must be an int >= 1' unless capacity.is_a?(Integer) && capacity >= 1
+
+        @channels = channels
+        @capacity = capacity
+        @type = type
+        @buffer = type.zeros(channels, capacity)
+
+        @read_count = 0
+        @write_count = 0
+      end
+
+      # Returns the number of frames that may be read.
+      def available
+        @write_count - @read_count
+      end
+
+      # Returns the number of frames that may be written without overflowing.
+      def space
+        @capacity - available
+      end
+
+      # Returns true if there is nothing to read.
+      def empty?
+        available == 0
+      end
+
+      # Returns true if there is no room to write.
+      def full?
+        available >= @capacity
+      end
+
+      # Copies as much of +data+ (an Array of Numo::NArrays, one per channel)
+      # into the buffer as will fit.  Returns the number of frames written,
+      # which will be less than the length of +data+ if the buffer filled up.
+      def write(data)
+        raise ArgumentError, "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+
+        frames = [data[0].length, space].min
+        return 0 if frames <= 0
+
+        start = @write_count % @capacity
+        first = [frames, @capacity - start].min
+
+        data.each_with_index do |c, idx|
+          @buffer[idx, start...(start + first)] = c[0...first]
+          @buffer[idx, 0...(frames - first)] = c[first...frames] if first < frames
+        end
+
+        @write_count += frames
+
+        frames
+      end
+
+      # Removes up to +frames+ frames from the buffer, returning an Array of
+      # Numo::NArrays with one element per channel.  Fewer frames will be
+      # returned if fewer are available.
+      #
+      # If +:out+ is given (an Array of Numo::NArrays at least +frames+ long),
+      # the data is copied into +:out+ instead of allocating new arrays, and
+      # views of the filled portion of each +:out+ array are returned.
+      def read(frames, out: nil)
+        frames = [frames, available].min
+        return @channels.times.map { @type.zeros(0) } if frames <= 0
+
+        out ||= @channels.times.map { @type.zeros(frames) }
+        copy_out(@read_count % @capacity, frames, out)
+        @read_count += frames
+
+        out.map { |c| c[0...frames] }
+      end
+
+      # Like #read, but leaves the data in the buffer.
+      def peek(frames, out: nil)
+        frames = [frames, available].min
+        return @channels.times.map { @type.zeros(0) } if frames <= 0
+
+        out ||= @channels.times.map { @type.zeros(frames) }
+        copy_out(@read_count % @capacity, frames, out)
+
+        out.map { |c| c[0...frames] }
+      end
+
+      # Discards up to +frames+ frames from the read side of the buffer without
+      # copying them.  Returns the number of frames discarded.  Like #read,
+      # this must only be called by the consumer.
+      def skip(frames)
+        frames = [frames, available].min
+        return 0 if frames <= 0
+
+        @read_count += frames
+        frames
+      end
+
+      # Discards all buffered data (only safe when neither the producer nor
+      # the consumer is active).
+      def clear
+        @read_count = @write_count
+      end
+
+      private
+
+      # Copies +frames+ frames starting at buffer position +start+ into the
+      # +out+ arrays.
+      def copy_out(start, frames, out)
+        first = [frames, @capacity - start].min
+
+        out.each_with_index do |c, idx|
+          c[0...first] = @buffer[idx, start...(start + first)]
+          c[first...frames] = @buffer[idx, 0...(frames - first)] if first < frames
+        end
+      end
+    end
+  end
+end
@@ -0,0 +1,269 @@
+module MB
+  module Sound
+    # A polyphonic sample player that reads directly from MappedSample files,
+    # so sample libraries don't need to be loaded into memory.  Samples are
+    # mapped to ranges of MIDI notes, and each note plays its sample at a
+    # fractional rate using linear interpolation, optionally looping between
+    # loop points.  A fixed pool of voices is allocated up front, with the
+    # oldest voice stolen when all are busy.
+    #
+    # Example:
+    #     sampler = MB::Sound::Sampler.new(voices: 16)
+    #     sampler.add_sample(MB::Sound::MappedSample.cached('piano_c4.flac'), root: 60, notes: 0..127)
+    #     sampler.trigger(64, 100)
+    #     output.write(sampler.sample(800))
+    class Sampler
+      # A sample mapped to a range of notes.
+      Zone = Struct.new(:sample, :root, :notes, :loop_start, :loop_end, keyword_init: true)
+
+      # One voice of the Sampler, playing one sample.  Voices are reused, so
+      # don't keep references to them after they stop.
+      class Voice
+        # The MappedSample being played.
+        attr_reader :sample
+
+        # The playback position in sample frames (fractional).
+        attr_reader :position
+
+        # The number of sample frames to advance per output sample.
+        attr_accessor :step
+
+        # The output gain.
+        attr_accessor :gain
+
+        # The loop start and end frames, or nil for no loop.
+        attr_accessor :loop_start, :loop_end
+
+        # The note number that triggered this voice, if any.
+        attr_reader :note
+
+        # Incremented each time a voice starts, for finding the oldest voice.
+        attr_reader :started_at
+
+        def initialize
+          @active = false
+        end
+
+        # Returns true if the voice is playing.
+        def active?
+          @active
+        end
+
+        # Returns true if the voice has been released and is fading out.
+        def releasing?
+          @active && !@release_step.nil?
+        end
+
+        # Starts playing +sample+ from frame +:start+, advancing +:step+
+        # frames per output sample.  Loops from +:loop_end+ back to
+        # +:loop_start+ if both are given.
+        def start(sample, step: 1.0, gain: 1.0, start: 0, loop_start: nil, loop_end: nil, note: nil, started_at: 0)
+          raise 'Step must be positive' unless step > 0
+          raise 'Loop end must be after loop start' if loop_start && loop_end && loop_end <= loop_start
+
+          @sample = sample
+          @step = step.to_f
+          @gain = gain
+          @position = start.to_f
+          @loop_start = loop_start
+          @loop_end = loop_end
+          @note = note
+          @started_at = started_at
+          @envelope = 1.0
+          @release_step = nil
+          @active = true
+
+          self
+        end
+
+        # Fades the voice out over +samples+ output samples, then stops it.
+        # Looping ends when the release starts, so the sample plays on past
+        # the loop end.
+        def release(samples)
+          return unless @active
+
+          if samples <= 0
+            stop
+          else
+            @release_step = @envelope / samples
+            @loop_start = nil
+            @loop_end = nil
+          end
+        end
+
+        # Stops the voice immediately.
+        def stop
+          @active = false
+          @sample = nil
+        end
+
+        # Adds +count+ samples of this voice to +out+ (a [count, channels]
+        # Numo::SFloat).  Stops the voice at the end of a non-looping sample
+        # or release.
+        def render(out, count)
+          offset = 0
+
+          while @active && offset < count
+            n = count - offset
+
+            if @loop_end && @loop_start
+              # Render up to the loop end, then wrap
+              @position -= (@loop_end - @loop_start) while @position >= @loop_end
+              n = [n, ((@loop_end - @position) / @step).ceil].min
+            else
+              remaining = ((@sample.frames - 1 - @position) / @step).floor + 1
+              if remaining <= 0
+                stop
+                break
+              end
+              n = [n, remaining].min
+            end
+
+            render_segment(out[offset...(offset + n), true], n)
+            offset += n
+          end
+        end
+
+        private
+
+        # Adds +n+ linearly interpolated samples starting at the current
+        # position, with no loop wrap inside the segment.
+        def render_segment(out, n)
+          positions = Numo::DFloat.new(n).seq(@position, @step)
+          first = @position.floor
+          last = positions[-1].floor + 1
+
+          # One read from the mapping covers the whole segment
+          data = @sample.read_frames(first, last - first + 1)
+
+          # The frame after the loop end is the loop start, not whatever
+          # follows the loop in the file (or zero padding at the end)
+          if @loop_start && @loop_end && last >= @loop_end
+            data[-1, true] = @sample.read_frames(@loop_start, 1)[0, true]
+          end
+
+          index = Numo::Int64.cast(positions.floor) - first
+          frac = Numo::SFloat.cast(positions - positions.floor).reshape(n, 1)
+
+          before = data[index, true]
+          after = data[index + 1, true]
+          value = (after - before) * frac
+          value.inplace + before
+
+          if @release_step
+            env = Numo::DFloat.new(n).seq(@envelope, -@release_step).clip(0, 1)
+            value.inplace * Numo::SFloat.cast(env).reshape(n, 1)
+            @envelope = env[-1] - @release_step
+          end
+          value.inplace * @gain
+          value.not_inplace!
+
+          # Map sample channels to output channels
+          if data.shape[1] == out.shape[1]
+            out.inplace + value
+            out.not_inplace!
+          else
+            out.shape[1].times do |c|
+              out[true, c] += value[true, c % data.shape[1]]
+            end
+          end
+
+          @position += n * @step
+          stop if @release_step && @envelope <= 0
+        end
+      end
+
+      # The number of output channels.
+      attr_reader :channels
+
+      # The output sample rate in Hz.
+      attr_reader :rate
+
+      # The voice pool.
+      attr_reader :voices
+
+      # The note-to-sample mapping (an Array of Zone).
+      attr_reader :zones
+
+      # The release time in seconds used by #release.
+      attr_accessor :release_time
+
+      # Initializes a sampler with +:voices+ voices producing +:channels+
+      # channels at +:rate+ Hz.
+      def initialize(voices: 16, channels: 2, rate: 48000, release_time: 0.05)
+        raise 'Voices must be an int >= 1' unless voices.is_a?(Integer) && voices >= 1
+        raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+
+        @channels = channels
+        @rate = rate
+        @release_time = release_time
+        @voices = voices.times.map { Voice.new }
+        @zones = []
+        @counter = 0
+        @buffer = Numo::SFloat.zeros(0, channels)
+      end
+
+      # Maps a MappedSample to a range of +:notes+, to be played at its
+      # original pitch at the +:root+ note.  The optional loop points are in
+      # sample frames.
+      def add_sample(sample, root:, notes: root..root, loop_start: nil, loop_end: nil)
+        @zones << Zone.new(sample: sample, root: root, notes: notes, loop_start: loop_start, loop_end: loop_end)
+        self
+      end
+
+      # Starts the sample mapped to MIDI note +note_number+, scaling volume
+      # by +velocity+ (0..127).  Returns the Voice, or nil if no sample is
+      # mapped to the note.
+      def trigger(note_number, velocity)
+        zone = @zones.find { |z| z.notes.include?(note_number) }
+        return nil if zone.nil?
+
+        step = 2.0 ** ((note_number - zone.root) / 12.0) * zone.sample.rate / @rate
+        gain = MB::M.scale(velocity, 0..127, -30..0).db
+
+        play(zone.sample, step: step, gain: gain, loop_start: zone.loop_start, loop_end: zone.loop_end, note: note_number)
+      end
+
+      # Releases all voices playing MIDI note +note_number+.  The velocity is
+      # ignored.
+      def release(note_number, velocity)
+        samples = (@release_time * @rate).round
+        @voices.each do |v|
+          v.release(samples) if v.active? && !v.releasing? && v.note == note_number
+        end
+      end
+
+      # Plays +sample+ on the next free (or oldest) voice.  Options are passed
+      # to Voice#start.  Returns the Voice.
+      def play(sample, **options)
+        voice = @voices.find { |v| !v.active? } || @voices.min_by(&:started_at)
+        @counter += 1
+        voice.start(sample, **options, started_at: @counter)
+      end
+
+      # Stops all voices immediately.
+      def stop
+        @voices.each(&:stop)
+      end
+
+      # Returns the number of voices playing.
+      def active_voices
+        @voices.count(&:active?)
+      end
+
+      # Returns the next +count+ samples of all voices mixed together, as an
+      # Array of Numo::SFloat with one element per channel.  Future calls may
+      # overwrite the returned data.
+      def sample(count)
+        @buffer = Numo::SFloat.zeros(count, @channels) if @buffer.shape[0] != count
+        @buffer.fill(0)
+
+        @voices.each do |v|
+          v.render(@buffer, count) if v.active?
+        end
+
+        @channels.times.map { |c| @buffer[true, c] }
+      end
+    end
+  end
+end
@@ -0,0 +1,284 @@
+require 'fiddle'
+require 'tmpdir'
+
+module MB
+  module Sound
+    # A single-producer, single-consumer ring buffer of planar 32-bit float
+    # audio in a shared memory file (in /dev/shm when available), for moving
+    # audio between Ruby processes on one host without pipes.  Each channel is
+    # stored contiguously, so there is no interleaving and no kernel pipe.
+    # Ruby can't copy directly between a Numo::NArray and the mapping, so
+    # each side makes two copies per channel: #write copies through a String
+    # (NArray#to_binary, then into the mapping), and #read copies out of the
+    # mapping into a String, then into a Numo::SFloat.
+    # See SharedRingOutput and SharedRingInput for blocking stream wrappers.
+    #
+    # The file starts with a header holding the format, the total frames
+    # written and read, a flag set when the writer is finished, and a flag
+    # set when the reader has closed.  As with RingBuffer, the producer only
+    # modifies the write counter and the consumer only modifies the read
+    # counter, and the counters increase forever.  Counters are read until
+    # two consecutive loads agree, since Ruby has no atomic 64-bit loads.
+    #
+    # Sample data is stored before the write counter is advanced, but Ruby
+    # has no memory fences, so the consumer is only guaranteed to see the
+    # data before the counter on CPUs that keep stores in order, such as
+    # x86.  On weakly ordered CPUs such as ARM, a reader could see a new
+    # counter before the samples it covers.
+    #
+    # Where mmap is not available through Fiddle, the file is accessed with
+    # IO#pread and IO#pwrite instead, which is slower but still shared.
+    #
+    # Example:
+    #     # Process A
+    #     ring = MB::Sound::SharedRing.new('/dev/shm/synth', channels: 2, capacity: 48000)
+    #     ring.write([left, right])
+    #
+    #     # Process B
+    #     ring = MB::Sound::SharedRing.open('/dev/shm/synth')
+    #     left, right = ring.read(800)
+    class SharedRing
+      # Identifies the file format.
+      MAGIC = 'MBSR'
+
+      # The header holds MAGIC, a version, channels, capacity, and rate, then
+      # the write counter, read counter, finished flag, and reader closed
+      # flag at their own aligned offsets, padded so sample data is well
+      # aligned.
+      HEADER_SIZE = 64
+      HEADER_FORMAT = 'a4L<L<L<L<'
+      VERSION = 1
+
+      WRITE_OFFSET = 32
+      READ_OFFSET = 40
+      FINISHED_OFFSET = 48
+      READER_CLOSED_OFFSET = 56
+
+      # The default directory for shared ring files.
+      DEFAULT_DIR = File.directory?('/dev/shm') ? '/dev/shm' : Dir.tmpdir
+
+      PROT_READ = 1
+      PROT_WRITE = 2
+      MAP_SHARED = 1
+
+      # Opens an existing shared ring created by another process.
+      def self.open(path)
+        new(path)
+      end
+
+      # Returns a new unique path in DEFAULT_DIR for a shared ring.
+      def self.temp_path(name = 'ring')
+        File.join(DEFAULT_DIR, "mb-sound-#{name}-#{Process.pid}-#{rand(1 << 32)}")
+      end
+
+      # The path to the shared file.
+      attr_reader :path
+
+      # The number of channels of audio in the ring.
+      attr_reader :channels
+
+      # The maximum number of frames the ring can hold.
+      attr_reader :capacity
+
+      # The sample rate given when the ring was created.
+      attr_reader :rate
+
+      # Creates a new shared ring at +path+ if +:channels+ and +:capacity+ are
+      # given (replacing any existing file), or opens an existing one.
+      def initialize(path, channels: nil, capacity: nil, rate: 48000)
+        @path = path
+
+        if channels || capacity
+          raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+          raise 'Capacity must be an int >= 1' unless capacity.is_a?(Integer) && capacity >= 1
+
+          # Written to a temporary name and renamed, so a reader never opens
+          # a ring without a header
+          tmp = "#{path}.#{Process.pid}.tmp"
+          @file = File.open(tmp, File::RDWR | File::CREAT | File::TRUNC | File::BINARY)
+          @file.truncate(HEADER_SIZE + channels * capacity * 4)
+          @file.pwrite([MAGIC, VERSION, channels, capacity, rate].pack(HEADER_FORMAT), 0)
+          File.rename(tmp, path)
+        else
+          @file = File.open(path, File::RDWR | File::BINARY)
+          magic, version, channels, capacity, rate = @file.pread(HEADER_SIZE, 0).unpack(HEADER_FORMAT)
+          raise "#{path} is not a shared ring" unless magic == MAGIC
+          raise "Unsupported shared ring version #{version}" unless version == VERSION
+        end
+
+        @channels = channels
+        @capacity = capacity
+        @rate = rate
+        @map = map_file
+      end
+
+      # Returns true if the file is memory mapped (rather than accessed with
+      # pread and pwrite).
+      def mapped?
+        !@map.nil?
+      end
+
+      # The total number of frames ever written to the ring.
+      def write_count
+        load_counter(WRITE_OFFSET)
+      end
+
+      # The total number of frames ever read from the ring.
+      def read_count
+        load_counter(READ_OFFSET)
+      end
+
+      # Returns the number of frames that may be read.
+      def available
+        write_count - read_count
+      end
+
+      # Returns the number of frames that may be written without overflowing.
+      def space
+        @capacity - available
+      end
+
+      # Copies as much of +data+ (an Array of Numo::NArrays, one per channel)
+      # into the ring as will fit.  Returns the number of frames written.
+      # Must only be called by the producer.
+      def write(data)
+        raise ArgumentError, "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+
+        count = write_count
+        frames = [data[0].length, @capacity - (count - read_count)].min
+        return 0 if frames <= 0
+
+        start = count % @capacity
+        first = [frames, @capacity - start].min
+
+        data.each_with_index do |c, idx|
+          c = Numo::SFloat.cast(c)
+          store(sample_offset(idx, start), c[0...first].to_binary)
+          store(sample_offset(idx, 0), c[first...frames].to_binary) if first < frames
+        end
+
+        store_counter(WRITE_OFFSET, count + frames)
+
+        frames
+      end
+
+      # Removes up to +frames+ frames from the ring, returning an Array of
+      # Numo::SFloat with one element per channel.  Fewer frames will be
+      # returned if fewer are available.  Must only be called by the consumer.
+      def read(frames)
+        count = read_count
+        frames = [frames, write_count - count].min
+        return @channels.times.map { Numo::SFloat[] } if frames <= 0
+
+        start = count % @capacity
+        first = [frames, @capacity - start].min
+
+        data = @channels.times.map { |idx|
+          bytes = load(sample_offset(idx, start), first * 4)
+          bytes << load(sample_offset(idx, 0), (frames - first) * 4) if first < frames
+          Numo::SFloat.from_binary(bytes)
+        }
+
+        store_counter(READ_OFFSET, count + frames)
+
+        data
+      end
+
+      # Marks the ring as finished, so the consumer knows no more data will be
+      # written.  Called by the producer.
+      def finish
+        store_counter(FINISHED_OFFSET, 1)
+      end
+
+      # Returns true if the producer has called #finish.
+      def finished?
+        load_counter(FINISHED_OFFSET) != 0
+      end
+
+      # Marks the ring as abandoned by the reader, so the writer knows no more
+      # data will be read.  Called by the consumer.
+      def close_reader
+        store_counter(READER_CLOSED_OFFSET, 1)
+      end
+
+      # Returns true if the consumer has called #close_reader.
+      def reader_closed?
+        load_counter(READER_CLOSED_OFFSET) != 0
+      end
+
+      # Unmaps and closes the file, without deleting it.
+      def close
+        if @map
+          MappedSample.munmap.call(@map, @map.size)
+          @map = nil
+        end
+        @file.close unless @file.closed?
+      end
+
+      # Returns true if the ring has been closed.
+      def closed?
+        @file.closed?
+      end
+
+      # Closes the ring and deletes its file.  Processes that already opened
+      # the ring may keep using it until they close it.
+      def unlink
+        close
+        File.unlink(@path) if File.exist?(@path)
+      end
+
+      private
+
+      # Returns the byte offset of +frame+ within channel +channel+.
+      def sample_offset(channel, frame)
+        HEADER_SIZE + (channel * @capacity + frame) * 4
+      end
+
+      # Reads +bytes+ bytes from +offset+.
+      def load(offset, bytes)
+        raise IOError, 'Shared ring is closed' if @file.closed?
+        @map ? @map[offset, bytes] : @file.pread(bytes, offset)
+      end
+
+      # Writes the String +data+ at +offset+.
+      def store(offset, data)
+        raise IOError, 'Shared ring is closed' if @file.closed?
+
+        if @map
+          @map[offset, data.bytesize] = data
+        else
+          @file.pwrite(data, offset)
+        end
+      end
+
+      # Reads the 64-bit counter at +offset+, repeating until two consecutive
+      # reads agree in case the other process was partway through writing it.
+      def load_counter(offset)
+        value = load(offset, 8)
+        loop do
+          again = load(offset, 8)
+          return value.unpack1('Q<') if again == value
+          value = again
+        end
+      end
+
+      # Writes the 64-bit counter at +offset+.
+      def store_counter(offset, value)
+        store(offset, [value].pack('Q<'))
+      end
+
+      # Maps the whole file for reading and writing, returning a
+      # Fiddle::Pointer, or nil if mmap is unavailable.
+      def map_file
+        mmap = MappedSample.mmap
+        return nil if mmap.nil?
+
+        ptr = mmap.call(nil, @file.size, PROT_READ | PROT_WRITE, MAP_SHARED, @file.fileno, 0)
+        return nil if ptr.null? || ptr.to_i == -1 || ptr.to_i == 2 ** (Fiddle::SIZEOF_VOIDP * 8) - 1
+
+        ptr.size = @file.size
+        ptr
+      end
+    end
+  end
+end
@@ -0,0 +1,82 @@
+module MB
+  module Sound
+    # A process_stream-compatible input stream that reads from a SharedRing
+    # created by a SharedRingOutput in another process.  Reads wait until the
+    # requested number of frames is available, or until the writer closes its
+    # end of the ring.
+    #
+    # Example:
+    #     input = MB::Sound::SharedRingInput.new('/dev/shm/synth')
+    #     loop do
+    #       data = input.read(800)
+    #       break if data[0].empty?
+    #       ...
+    #     end
+    #     input.close
+    class SharedRingInput
+      # The SharedRing being read.
+      attr_reader :ring
+
+      # The number of frames to read at a time.
+      attr_reader :buffer_size
+
+      # The number of frames that have been read.
+      attr_reader :frames_read
+
+      # Opens the SharedRing at +path+ for reading.  If +:wait+ is nonzero,
+      # waits up to that many seconds for the writer to create the ring.  The
+      # +:poll+ interval is how long to sleep while waiting for data.
+      def initialize(path, buffer_size: 800, poll: 0.001, wait: 0)
+        deadline = ::MB::U.clock_now + wait
+        until File.exist?(path) && File.size(path) >= SharedRing::HEADER_SIZE
+          raise "Shared ring #{path} does not exist" if ::MB::U.clock_now >= deadline
+          Kernel.sleep(poll)
+        end
+
+        @ring = SharedRing.open(path)
+        @buffer_size = buffer_size
+        @poll = poll
+        @frames_read = 0
+      end
+
+      # The number of channels in the ring.
+      def channels
+        @ring.channels
+      end
+
+      # The sample rate of the ring.
+      def rate
+        @ring.rate
+      end
+
+      # Reads +frames+ frames, waiting for the writer if necessary.  Returns
+      # an Array of Numo::SFloat with one element per channel, which will be
+      # shorter than +frames+ (or empty) only at the end of the stream.
+      def read(frames)
+        raise IOError, 'Input is closed' if closed?
+
+        frames = [frames, @ring.capacity].min
+        until @ring.available >= frames || @ring.finished?
+          Kernel.sleep(@poll)
+        end
+
+        data = @ring.read(frames)
+        @frames_read += data[0].length
+        data
+      end
+
+      # Tells the writer the reader has closed, then closes the ring and
+      # deletes its file.
+      def close
+        return if closed?
+        @ring.close_reader
+        @ring.unlink
+      end
+
+      # Returns true if the input has been closed.
+      def closed?
+        @ring.closed?
+      end
+    end
+  end
+end
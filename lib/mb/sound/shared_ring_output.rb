@@ -0,0 +1,80 @@
+module MB
+  module Sound
+    # A process_stream-compatible output stream that writes to a SharedRing,
+    # for sending audio to a SharedRingInput in another process.  Writes wait
+    # for the reader to make room when the ring is full, and raise IOError if
+    # the reader has closed the ring.
+    #
+    # Example:
+    #     output = MB::Sound::SharedRingOutput.new('/dev/shm/synth', channels: 2)
+    #     pid = fork { input = MB::Sound::SharedRingInput.new('/dev/shm/synth'); ... }
+    #     output.write([left, right])
+    #     output.close
+    class SharedRingOutput
+      # The SharedRing being written.
+      attr_reader :ring
+
+      # The number of frames to write at a time.
+      attr_reader :buffer_size
+
+      # The number of frames that have been written.
+      attr_reader :frames_written
+
+      # Creates a SharedRing at +path+ holding +:capacity+ frames (four buffers
+      # by default) for writing.  The +:poll+ interval is how long to sleep
+      # while waiting for the reader to make room.
+      def initialize(path, channels:, rate: 48000, buffer_size: 800, capacity: nil, poll: 0.001)
+        @ring = SharedRing.new(path, channels: channels, capacity: capacity || buffer_size * 4, rate: rate)
+        @buffer_size = buffer_size
+        @poll = poll
+        @frames_written = 0
+      end
+
+      # The number of channels in the ring.
+      def channels
+        @ring.channels
+      end
+
+      # The sample rate of the ring.
+      def rate
+        @ring.rate
+      end
+
+      # Writes the given Array of Numo::NArrays (one per channel) to the ring,
+      # waiting for space as needed.  Returns the number of frames written.
+      def write(data)
+        raise IOError, 'Output is closed' if closed?
+        raise ArgumentError, "Received #{data.length} channels when #{channels} were expected" if data.length != channels
+
+        total = data[0].length
+        offset = 0
+
+        while offset < total
+          frames = @ring.write(offset == 0 ? data : data.map { |c| c[offset..-1] })
+          if frames == 0
+            raise IOError, 'The shared ring reader has closed' if @ring.reader_closed?
+            Kernel.sleep(@poll)
+          else
+            offset += frames
+          end
+        end
+
+        @frames_written += total
+        total
+      end
+
+      # Marks the ring as finished so the reader sees the end of the stream,
+      # then closes this side of the ring.  The reader deletes the file.
+      def close
+        return if closed?
+        @ring.finish
+        @ring.close
+      end
+
+      # Returns true if the output has been closed.
+      def closed?
+        @ring.closed?
+      end
+    end
+  end
+end
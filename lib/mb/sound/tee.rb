@@ -0,0 +1,289 @@
+module MB
+  module Sound
+    # An input stream wrapper that shares each buffer read from an input with
+    # any number of consumers (e.g. meters, spectrum displays, or pitch
+    # detectors) without copying.  Every consumer receives the same arrays
+    # that #read returns to the main processing path.
+    #
+    # Consumers may run synchronously during #read, or on their own threads
+    # with a bounded queue, and may take only every Nth buffer.  A threaded
+    # consumer whose queue is full skips buffers rather than delaying #read.
+    #
+    # Each buffer is reference counted, with one reference held by the main
+    # path and one by each consumer it was given to.  Because nothing is
+    # copied, the main path must not modify a buffer's data in place until
+    # the consumers have released it.  #read_buffer returns the Buffer
+    # itself, whose Buffer#exclusive waits for the consumers' references to
+    # be released before returning the data for in-place processing.  The
+    # main path then calls Buffer#release.  #read releases the previous
+    # buffer automatically, and its arrays must not be modified in place
+    # while threaded consumers may still be reading them (synchronous
+    # consumers are finished before #read returns).  #live_buffers shows how
+    # many buffers have not been fully released.
+    #
+    # Example:
+    #     tee = MB::Sound::Tee.new(MB::Sound.input)
+    #     tee.add_consumer(every: 4, thread: true) { |data| puts data[0].abs.max.to_db }
+    #     loop do
+    #       output.write(filter.process(tee.read(800)))
+    #     end
+    #
+    # Example (in-place processing):
+    #     loop do
+    #       buffer = tee.read_buffer(800)
+    #       data = buffer.exclusive
+    #       data.each { |c| (c.inplace * 0.5).not_inplace! }
+    #       output.write(data)
+    #       buffer.release
+    #     end
+    class Tee
+      # A buffer shared between the main path and consumers.
+      class Buffer
+        # The Array of channel data given to consumers.
+        attr_reader :data
+
+        # The buffer's sequence number, starting at 0.
+        attr_reader :index
+
+        def initialize(tee, data, index, refs)
+          @tee = tee
+          @data = data
+          @index = index
+          @refs = refs
+        end
+
+        # Returns the number of holders that have not released the buffer.
+        def refs
+          @tee.synchronize { @refs }
+        end
+
+        # Releases one reference to the buffer.
+        def release
+          @tee.synchronize do
+            raise 'Buffer released too many times' if @refs <= 0
+            @refs -= 1
+            @tee.send(:buffer_released, @refs)
+          end
+        end
+
+        # Waits until every consumer has released the buffer, leaving only
+        # the main path's reference, then returns #data, which the main path
+        # may then modify in place.  Call #release afterward as usual.
+        def exclusive
+          @tee.send(:wait_for_release) { @refs > 1 }
+          @data
+        end
+      end
+
+      # A consumer of buffers from a Tee.  See Tee#add_consumer.
+      class Consumer
+        # The consumer receives every +every+th buffer.
+        attr_reader :every
+
+        # The number of buffers the consumer has processed.
+        attr_reader :received
+
+        # The number of buffers skipped because the consumer's queue was full.
+        attr_reader :dropped
+
+        # The first error raised by a threaded consumer's block, if any.
+        attr_reader :error
+
+        def initialize(every:, thread:, queue_size:, &block)
+          raise 'Every must be an int >= 1' unless every.is_a?(Integer) && every >= 1
+          raise 'A block is required' unless block
+
+          @every = every
+          @block = block
+          @received = 0
+          @dropped = 0
+          @queue_size = queue_size
+
+          if thread
+            @queue = Queue.new
+            @thread = Thread.new do
+              Thread.current.name = 'Tee consumer'
+              Thread.current.report_on_exception = false
+              run
+            end
+          end
+        end
+
+        # Returns true if the consumer runs on its own thread.
+        def threaded?
+          !@thread.nil?
+        end
+
+        # Returns true if the consumer wants the buffer with the given index.
+        def wants?(index)
+          index % @every == 0
+        end
+
+        # Gives the consumer a reference to +buffer+, which the consumer
+        # releases when finished (or immediately if it is skipped).
+        def deliver(buffer)
+          if @queue.nil?
+            begin
+              call(buffer)
+            ensure
+              buffer.release
+            end
+          elsif @queue.length >= @queue_size || @error
+            @dropped += 1
+            buffer.release
+          else
+            @queue.push(buffer)
+          end
+        end
+
+        # Stops the consumer's thread after it processes the buffers already
+        # queued.
+        def stop
+          return unless @thread
+          @queue.push(nil)
+          @thread.join
+          @thread = nil
+        end
+
+        private
+
+        def call(buffer)
+          @block.call(buffer.data, buffer.index)
+          @received += 1
+        end
+
+        def run
+          while (buffer = @queue.pop)
+            begin
+              call(buffer) unless @error
+            rescue => e
+              @error = e
+            ensure
+              buffer.release
+            end
+          end
+        end
+      end
+
+      # The wrapped input stream.
+      attr_reader :input
+
+      # The consumers added with #add_consumer.
+      attr_reader :consumers
+
+      # Initializes a tee that reads from the given +input+ stream (anything
+      # with a #read method, like FFMPEGInput or ArrayInput).
+      def initialize(input)
+        raise 'Input must respond to :read' unless input.respond_to?(:read)
+
+        @input = input
+        @consumers = []
+        @count = 0
+        @live = 0
+        @mutex = Mutex.new
+        @released = ConditionVariable.new
+        @last_buffer = nil
+      end
+
+      # The number of channels of the input.
+      def channels
+        @input.channels
+      end
+
+      # The sample rate of the input, if known.
+      def rate
+        @input.rate if @input.respond_to?(:rate)
+      end
+
+      # The buffer size of the input, if known.
+      def buffer_size
+        @input.buffer_size if @input.respond_to?(:buffer_size)
+      end
+
+      # Adds a consumer that is called with each buffer's Array of channel
+      # data and its index.  The consumer is given every +:every+th buffer.
+      # If +:thread+ is true, the consumer runs on its own thread with up to
+      # +:queue_size+ buffers waiting.  Returns the Consumer.
+      #
+      # The block must not modify the data, which is shared with the main
+      # path and other consumers.
+      def add_consumer(every: 1, thread: false, queue_size: 4, &block)
+        consumer = Consumer.new(every: every, thread: thread, queue_size: queue_size, &block)
+        @consumers << consumer
+        consumer
+      end
+
+      # Reads +frames+ frames from the input and gives the same arrays to
+      # every consumer that wants this buffer, then returns them.  The main
+      # path's reference to the previous buffer is released.
+      def read(frames)
+        @last_buffer&.release
+        @last_buffer = nil
+
+        @last_buffer = read_buffer(frames)
+        @last_buffer.data
+      end
+
+      # Reads +frames+ frames from the input and gives the same arrays to
+      # every consumer that wants this buffer, then returns the Buffer.  The
+      # caller holds the main path's reference, and must call Buffer#release
+      # when finished with it.  Use Buffer#exclusive before modifying the
+      # data in place.
+      def read_buffer(frames)
+        data = @input.read(frames)
+
+        index = @count
+        @count += 1
+
+        targets = @consumers.select { |c| c.wants?(index) }
+        buffer = Buffer.new(self, data, index, targets.length + 1)
+        synchronize { @live += 1 }
+
+        # Threaded consumers first, so they can start while synchronous
+        # consumers run
+        targets.sort_by { |c| c.threaded? ? 0 : 1 }.each do |c|
+          c.deliver(buffer)
+        end
+
+        buffer
+      end
+
+      # Returns the number of buffers that have not been released by the main
+      # path and all of their consumers.
+      def live_buffers
+        synchronize { @live }
+      end
+
+      # Stops consumer threads after they finish their queued buffers, and
+      # closes the input if it can be closed.
+      def close
+        @consumers.each(&:stop)
+        @last_buffer&.release
+        @last_buffer = nil
+        @input.close if @input.respond_to?(:close)
+      end
+
+      # Runs the block while holding the tee's lock (used by Buffer).
+      def synchronize(&block)
+        @mutex.owned? ? yield : @mutex.synchronize(&block)
+      end
+
+      private
+
+      # Called by Buffer#release with the lock held, with the number of
+      # references remaining.  Wakes anything waiting in #wait_for_release.
+      def buffer_released(refs)
+        @live -= 1 if refs == 0
+        @released.broadcast
+      end
+
+      # Waits while the block returns true, checking again each time a
+      # buffer reference is released (used by Buffer#exclusive).
+      def wait_for_release
+        @mutex.synchronize do
+          @released.wait(@mutex) while yield
+        end
+      end
+    end
+  end
+end
@@ -146,6 +146,13 @@ module MB
       end
       ::Numeric.include NumericToneMethods
 
+      class << self
+        # The ToneCache shared by all tones for rendered samples, or nil to
+        # disable caching.
+        attr_accessor :cache
+      end
+      self.cache = ToneCache.new
+
       attr_reader :wave_type, :frequency, :amplitude, :range, :duration, :rate, :wavelength, :phase
 
       # Initializes a representation of a simple generated waveform.
@@ -307,9 +314,13 @@ module MB
       # Generates +count+ samples of the tone, defaulting to the duration of
       # the tone, or one second of samples if duration is infinite.  The tone
       # parameters cannot be changed after this method is called.
+      #
+      # Samples are copied from Tone.cache when possible (see #cached_samples).
+      # As with Oscillator#sample, future calls may overwrite the buffer
+      # returned by previous calls.
       def generate(count = nil)
         count ||= @duration ? @duration * @rate : @rate
-        oscillator.sample(count.round)
+        cached_samples(count.round) || oscillator.sample(count.round)
       end
 
       # Returns an Oscillator that will generate a wave with the wave type,
@@ -317,15 +328,10 @@ module MB
       # (e.g. by the Note subclass), the Oscillator will change frequency as
       # well, but other parameters likely won't be changed by changing the
       # Tone.
+      #
+      # Once the oscillator is created, the tone no longer uses Tone.cache.
       def oscillator
-        @oscillator ||= MB::Sound::Oscillator.new(
-          @wave_type,
-          frequency: @frequency,
-          phase: @phase,
-          advance: @noise ? 0 : Math::PI * 2.0 / @rate,
-          random_advance: @noise ? Math::PI * 2.0 : 0,
-          range: @range
-        )
+        @oscillator ||= new_oscillator
       end
 
       # Returns a second-order low-pass Filter with this Tone's frequency as its
@@ -403,10 +409,23 @@ module MB
         buffer_size = output.buffer_size
         samples_left = @duration * @rate if @duration
 
+        # The same buffer is written to every channel, and only the final
+        # partial buffer is copied, into a reused padding buffer
+        channels = Array.new(output.channels)
+        padded = nil
+
         loop do
           current_samples = [samples_left || buffer_size, buffer_size].min
-          d = [ MB::M.zpad(generate(current_samples), buffer_size) ]
-          output.write(d * output.channels)
+          d = generate(current_samples)
+
+          if d.length < buffer_size
+            padded = d.class.zeros(buffer_size) if padded.nil? || padded.class != d.class
+            padded[0...d.length] = d
+            padded[d.length..-1] = 0
+            d = padded
+          end
+
+          output.write(channels.fill(d))
 
           if samples_left
             samples_left -= current_samples
@@ -421,6 +440,92 @@ module MB
 
       private
 
+      # Returns a new Oscillator for this tone's parameters.
+      def new_oscillator
+        MB::Sound::Oscillator.new(
+          @wave_type,
+          frequency: @frequency,
+          phase: @phase,
+          advance: @noise ? 0 : Math::PI * 2.0 / @rate,
+          random_advance: @noise ? Math::PI * 2.0 : 0,
+          range: @range
+        )
+      end
+
+      # Returns the next +count+ samples copied from Tone.cache into a reused
+      # buffer, or nil if the tone can't be served from the cache (e.g. it is
+      # noise, or the oscillator has already been created).
+      #
+      # Tones with a duration of up to ToneCache#max_tone_samples cache their
+      # full rendering; longer tones aren't cached, so playback doesn't wait
+      # for the whole tone to render before the first buffer.  Infinite tones
+      # cache the shortest whole number of cycles that is also a whole number
+      # of samples (see #cycle_length) and tile it.  If a finite tone is read
+      # past its rendered duration, the oscillator is advanced to the current
+      # position and takes over.
+      def cached_samples(count)
+        cache = Tone.cache
+        return nil if cache.nil? || @noise || @oscillator || @frequency <= 0
+
+        @cache_position ||= 0
+        base_key = [@wave_type, @frequency, @range.begin, @range.end, @phase, @rate]
+
+        if @duration
+          total = (@duration * @rate).round
+          if @cache_position + count > total || total > [cache.max_samples, cache.max_tone_samples].min
+            oscillator.sample(@cache_position) if @cache_position > 0
+            return nil
+          end
+
+          source = cache.fetch(base_key + [@duration]) { new_oscillator.sample(total).dup }
+        else
+          length = cycle_length
+          return nil if length.nil?
+
+          source = cache.fetch(base_key + [:cycle]) { new_oscillator.sample(length).dup }
+        end
+
+        if @cache_buffer.nil? || @cache_buffer.class != source.class || @cache_buffer.length != count
+          @cache_buffer = source.class.zeros(count)
+        end
+
+        # Copy (and tile, for a cycle) from the current position
+        offset = 0
+        while offset < count
+          start = @cache_position % source.length
+          n = [count - offset, source.length - start].min
+          @cache_buffer[offset...(offset + n)] = source[start...(start + n)]
+          offset += n
+          @cache_position += n
+        end
+
+        @cache_buffer
+      end
+
+      # Returns the length in samples of the shortest whole number of cycles
+      # that is within a billionth of a whole number of samples, or nil if
+      # that would be longer than one second.  The result (even nil) is
+      # remembered until the frequency or sample rate changes, as finding it
+      # may take thousands of iterations.
+      def cycle_length
+        key = [@frequency, @rate]
+        return @cycle_length if @cycle_length_key == key
+
+        @cycle_length_key = key
+        @cycle_length = nil
+
+        period = @rate / @frequency
+        (1..(@rate / period).floor).each do |cycles|
+          length = period * cycles
+          if (length - length.round).abs < 1e-9 * cycles
+            @cycle_length = length.round
+            break
+          end
+        end
+
+        @cycle_length
+      end
+
       # Allows subclasses (e.g. Note) to change the frequency after construction.
       def set_frequency(freq)
         freq = SPEED_OF_SOUND / freq.meters if freq.is_a?(Feet) || freq.is_a?(Meters)
@@ -0,0 +1,99 @@
+module MB
+  module Sound
+    # A bounded least-recently-used cache of rendered sample buffers, used by
+    # Tone to avoid regenerating the same tones over and over (e.g. when
+    # playing 100.hz.for(0.25) in a loop).  The total size of all buffers is
+    # limited to +:max_samples+, with the least recently used buffers evicted
+    # first.  Tones longer than +:max_tone_samples+ are not cached at all,
+    # so the first buffer of a long tone doesn't wait for the whole tone to
+    # be rendered.
+    #
+    # Callers must not modify the buffers returned by #fetch.
+    #
+    # Example:
+    #     cache = MB::Sound::ToneCache.new(max_samples: 480000)
+    #     cache.fetch([:sine, 100, 48000]) { expensive_render } # renders
+    #     cache.fetch([:sine, 100, 48000]) { expensive_render } # cached
+    class ToneCache
+      # The maximum total number of samples in all cached buffers.
+      attr_reader :max_samples
+
+      # The longest finite tone, in samples, that Tone will render in full
+      # and cache.  Longer tones are generated as they play.
+      attr_reader :max_tone_samples
+
+      # The total number of samples in all cached buffers.
+      attr_reader :samples
+
+      # The number of calls to #fetch that were served from the cache.
+      attr_reader :hits
+
+      # The number of calls to #fetch that called the block.
+      attr_reader :misses
+
+      # Initializes an empty cache holding up to +:max_samples+ samples, in
+      # which Tone caches finite tones of up to +:max_tone_samples+ samples.
+      def initialize(max_samples: 48000 * 60, max_tone_samples: 48000 * 2)
+        raise 'Max samples must be an int >= 0' unless max_samples.is_a?(Integer) && max_samples >= 0
+        raise 'Max tone samples must be an int >= 0' unless max_tone_samples.is_a?(Integer) && max_tone_samples >= 0
+
+        @max_samples = max_samples
+        @max_tone_samples = max_tone_samples
+        @entries = {}
+        @samples = 0
+        @hits = 0
+        @misses = 0
+      end
+
+      # Returns the buffer cached for +key+, or calls the block to render it
+      # and caches the result (unless it is larger than #max_samples).
+      def fetch(key)
+        if (buffer = @entries.delete(key))
+          # Reinsert to mark as most recently used
+          @entries[key] = buffer
+          @hits += 1
+          return buffer
+        end
+
+        @misses += 1
+        buffer = yield
+        store(key, buffer)
+        buffer
+      end
+
+      # Returns true if a buffer is cached for +key+, without changing its
+      # position in the eviction order.
+      def include?(key)
+        @entries.include?(key)
+      end
+
+      # Returns the number of cached buffers.
+      def size
+        @entries.size
+      end
+
+      # Removes all cached buffers.
+      def clear
+        @entries.clear
+        @samples = 0
+        self
+      end
+
+      private
+
+      # Adds +buffer+ to the cache, evicting old buffers to make room.
+      def store(key, buffer)
+        return if buffer.length > @max_samples
+
+        while @samples + buffer.length > @max_samples
+          old_key, old_buffer = @entries.first
+          @entries.delete(old_key)
+          @samples -= old_buffer.length
+        end
+
+        @entries[key] = buffer
+        @samples += buffer.length
+      end
+    end
+  end
+end
@@ -0,0 +1,327 @@
+module MB
+  module Sound
+    # A connected pair of in-process virtual audio devices.  Audio written to
+    # #output can be read back from #input after passing through a shared
+    # RingBuffer, like a sound card with its output cabled to its input.
+    # Primarily used for testing and benchmarking streaming loops without
+    # audio hardware.
+    #
+    # Both ends are paced by a drift-free Clock at the device sample rate, and
+    # faults seen on real devices can be injected: wake-up +:jitter+, xruns
+    # (a whole period lost), and short reads (fewer frames returned than
+    # requested).  Injected faults are drawn from a Random seeded with
+    # +:seed+, so a run can be repeated exactly.  With +:realtime+ set to
+    # false, the clocks advance virtually instead of sleeping, so loops run as
+    # fast as possible with fully deterministic behavior.
+    #
+    # Example:
+    #     dev = MB::Sound::VirtualDevice.new(channels: 2, period: 480, jitter: 0.002, xrun_chance: 0.01, seed: 1)
+    #     MB::Sound.process_time_stream(dev.input, dev.output, 960, 480)
+    class VirtualDevice
+      # Paces reads or writes to a sample rate.  Deadlines are computed from
+      # the total number of frames since the clock started, rather than by
+      # accumulating individual sleep durations, so scheduling delays and
+      # jitter never add up to drift.
+      class Clock
+        # The sample rate of the clock, in Hz.
+        attr_reader :rate
+
+        # The total number of frames the clock has advanced.
+        attr_reader :frames
+
+        # Initializes a clock at the given sample +rate+.  If +:realtime+ is
+        # false, the clock never sleeps, and time advances only as frames are
+        # counted.
+        def initialize(rate, realtime: true)
+          raise 'Rate must be a positive number' unless rate.is_a?(Numeric) && rate > 0
+
+          @rate = rate.to_f
+          @realtime = realtime
+          @frames = 0
+          @start = nil
+        end
+
+        # Returns true if this clock sleeps in real time.
+        def realtime?
+          @realtime
+        end
+
+        # Returns the number of seconds since the clock started (at the first
+        # call to #advance).
+        def now
+          if @realtime
+            @start ? monotonic - @start : 0.0
+          else
+            @frames / @rate
+          end
+        end
+
+        # Advances the clock by +frames+, then sleeps until the time those
+        # frames will have finished, less +:lead+ frames that the caller is
+        # allowed to run ahead (e.g. an output's buffer size), plus +:jitter+
+        # seconds.  Returns how many seconds late the caller was, relative to
+        # the end of the previously advanced frames (0 if not late).
+        def advance(frames, jitter: 0, lead: 0)
+          unless @realtime
+            @frames += frames
+            return 0.0
+          end
+
+          now = monotonic
+          @start ||= now
+
+          lateness = now - (@start + @frames / @rate)
+          lateness = 0.0 if lateness < 0
+
+          @frames += frames
+          delay = @start + (@frames - lead) / @rate + jitter - now
+          Kernel.sleep(delay) if delay > 0
+
+          lateness
+        end
+
+        private
+
+        def monotonic
+          Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        end
+      end
+
+      # Shared code for both ends of the virtual device.
+      class Endpoint
+        attr_reader :device, :channels, :rate, :buffer_size, :clock
+
+        def initialize(device)
+          @device = device
+          @channels = device.channels
+          @rate = device.rate
+          @buffer_size = device.period
+          @clock = Clock.new(device.rate, realtime: device.realtime)
+          @closed = false
+        end
+
+        # Closes this end of the device, preventing further use.
+        def close
+          @closed = true
+        end
+
+        # Returns true if this end of the device has been closed.
+        def closed?
+          @closed
+        end
+      end
+
+      # The capture side of a VirtualDevice.
+      class Input < Endpoint
+        # The number of frames returned by #read, including zeros filled in
+        # for underruns.
+        attr_reader :frames_read
+
+        def initialize(device)
+          super
+          @frames_read = 0
+        end
+
+        # Waits for +frames+ frames of audio to be "captured", then returns an
+        # Array of Numo::SFloat with one element per channel.  Fewer frames
+        # may be returned if short reads are being injected.  If less audio
+        # was written to the output than is being read, the missing frames are
+        # filled with zeros and counted as an underrun.
+        def read(frames)
+          raise 'This input is closed' if @closed
+          raise 'Must read at least one frame' if frames < 1
+
+          frames = @device.short_read(frames)
+
+          lateness = @clock.advance(frames, jitter: @device.next_jitter)
+
+          if @device.inject_xrun? || lateness > @device.latency
+            # The device overran while nobody was reading, so audio is lost
+            @device.count_xrun
+            @device.ring.skip(frames)
+            data = @channels.times.map { Numo::SFloat.zeros(frames) }
+          else
+            data = @device.ring.read(frames)
+            missing = frames - data[0].length
+            if missing > 0
+              @device.count_underrun(missing)
+              data = data.map { |c|
+                Numo::SFloat.zeros(frames).tap { |z| z[0...c.length] = c if c.length > 0 }
+              }
+            end
+          end
+
+          @frames_read += frames
+
+          data
+        end
+      end
+
+      # The playback side of a VirtualDevice.
+      class Output < Endpoint
+        # The number of frames given to #write, including frames that were
+        # dropped due to xruns or overruns.
+        attr_reader :frames_written
+
+        def initialize(device)
+          super
+          @frames_written = 0
+        end
+
+        # Waits until the device has room for +data+ (an Array of Numo::NArray
+        # with one element per channel), then passes it to the input.  If the
+        # input isn't reading fast enough the excess is dropped and counted as
+        # an overrun.  If the caller was so late that the device would have
+        # run out of audio, or an xrun is injected, the data is dropped and
+        # counted as an xrun.  Returns the number of frames given.
+        def write(data)
+          raise 'This output is closed' if @closed
+          raise "Expected #{@channels} channels, got #{data.length}" unless @channels == data.length
+
+          frames = data[0].length
+          lateness = @clock.advance(frames, jitter: @device.next_jitter, lead: @device.ring.capacity)
+
+          # Playback starts once the buffer has filled, so the device only
+          # runs dry if the caller falls more than a full buffer behind
+          if @device.inject_xrun? || lateness > @device.latency
+            @device.count_xrun
+          else
+            written = @device.ring.write(data)
+            @device.count_overrun(frames - written) if written < frames
+          end
+
+          @frames_written += frames
+
+          frames
+        end
+      end
+
+      # The number of audio channels on each end of the device.
+      attr_reader :channels
+
+      # The device sample rate in Hz.
+      attr_reader :rate
+
+      # The number of frames in one device period (the hardware buffer
+      # granularity).  This is also the #buffer_size of each end.
+      attr_reader :period
+
+      # The number of periods of buffering between the output and the input.
+      attr_reader :periods
+
+      # Whether the device clocks sleep in real time.
+      attr_reader :realtime
+
+      # The shared RingBuffer between the output and input.
+      attr_reader :ring
+
+      # The capture end of the device (see Input).
+      attr_reader :input
+
+      # The playback end of the device (see Output).
+      attr_reader :output
+
+      # Fault counters (see #initialize).
+      attr_reader :xruns, :underruns, :overruns, :short_reads
+
+      # Initializes a virtual device pair.
+      #
+      # +:channels+ - The number of channels on both ends.
+      # +:rate+ - The sample rate, in Hz.
+      # +:period+ - The device period in frames (the buffer size of each end).
+      # +:periods+ - How many periods of audio can be buffered between ends.
+      # +:realtime+ - If false, never sleep (see the class description).
+      # +:jitter+ - The maximum random extra delay in seconds added to each
+      #             wake-up.  Never accumulates into drift.
+      # +:xrun_chance+ - The probability (0..1) of an injected xrun on each
+      #                  read or write.
+      # +:short_read_chance+ - The probability (0..1) that a read returns
+      #                        fewer frames than requested.
+      # +:seed+ - A seed for the Random used to inject faults.
+      def initialize(channels: 2, rate: 48000, period: 256, periods: 4, realtime: true, jitter: 0, xrun_chance: 0, short_read_chance: 0, seed: nil)
+        raise 'Channels must be an int >= 1' unless channels.is_a?(Integer) && channels >= 1
+        raise 'Period must be an int >= 1' unless period.is_a?(Integer) && period >= 1
+        raise 'Periods must be an int >= 2' unless periods.is_a?(Integer) && periods >= 2
+
+        @channels = channels
+        @rate = rate
+        @period = period
+        @periods = periods
+        @realtime = realtime
+
+        @jitter = jitter.to_f
+        @xrun_chance = xrun_chance.to_f
+        @short_read_chance = short_read_chance.to_f
+        @random = seed ? Random.new(seed) : Random.new
+
+        @ring = RingBuffer.new(channels: channels, capacity: period * periods)
+
+        @xruns = 0
+        @underruns = 0
+        @overruns = 0
+        @short_reads = 0
+
+        @input = Input.new(self)
+        @output = Output.new(self)
+      end
+
+      # Returns the number of seconds of audio the device can buffer.  A
+      # caller that is later than this misses the device's deadline.
+      def latency
+        @ring.capacity.to_f / @rate
+      end
+
+      # Returns a Hash with all of the fault counters.
+      def stats
+        {
+          xruns: @xruns,
+          underruns: @underruns,
+          overruns: @overruns,
+          short_reads: @short_reads,
+        }
+      end
+
+      # Closes both ends of the device.
+      def close
+        @input.close
+        @output.close
+      end
+
+      # For internal use by Input and Output.  Returns a random wake-up delay
+      # within the configured jitter.
+      def next_jitter
+        @jitter > 0 ? @random.rand(@jitter) : 0
+      end
+
+      # For internal use by Input and Output.  Returns true if an xrun should
+      # be injected.
+      def inject_xrun?
+        @xrun_chance > 0 && @random.rand < @xrun_chance
+      end
+
+      # For internal use by Input.  Returns a possibly reduced frame count to
+      # simulate a short read.
+      def short_read(frames)
+        return frames unless frames > 1 && @short_read_chance > 0 && @random.rand < @short_read_chance
+
+        @short_reads += 1
+        @random.rand(1...frames)
+      end
+
+      # For internal use by Input and Output.
+      def count_xrun
+        @xruns += 1
+      end
+
+      # For internal use by Input.
+      def count_underrun(frames)
+        @underruns += frames
+      end
+
+      # For internal use by Output.
+      def count_overrun(frames)
+        @overruns += frames
+      end
+    end
+  end
+end
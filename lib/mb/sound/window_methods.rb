@@ -65,6 +65,8 @@ module MB
       #       dfts.map { |c| c * scale }
       #     end
       #     play '/tmp/darker.flac'
+      #
+      # See #process_large for files too large to transform in memory.
       def process(in_filename, out_filename, &block)
         raise 'No block given' unless block_given?
 
@@ -125,7 +127,7 @@ module MB
         frames = channels.first.size
 
         hop_size = split_size - overlap_size
-        fade_in = linear_fade(0, 1, overlap_size)
+        fade_in = Numo::SFloat.linspace(0, 1, overlap_size)
         fade_out = 1 - fade_in
 
         count = 0
@@ -165,6 +167,203 @@ module MB
         write(out_filename, outputs)
       end
 
+      # Streaming version of #process.  The whole file must still be read into
+      # memory for its single DFT, but the result is written in chunks instead
+      # of being normalized in memory (see #stream_process_split for +:gain+).
+      #
+      # Input files are always resampled to 48kHz.
+      def stream_process(in_filename, out_filename, gain: nil, &block)
+        raise 'No block given' unless block_given?
+
+        channels = read(in_filename)
+        frames = channels.first.size
+
+        dfts = channels.map { |c| real_fft(c).inplace! }
+        channels = nil
+        modified = yield dfts
+        results = modified.map { |c| real_ifft(c, odd_length: frames.odd?) }
+
+        output = stream_output(out_filename, results.size, gain)
+        (0...frames).step(NormalizingOutput::COPY_SIZE) do |offset|
+          range = offset...[offset + NormalizingOutput::COPY_SIZE, frames].min
+          write_stream_chunk(output, results.map { |c| c[range] }, gain)
+        end
+      ensure
+        output&.close
+      end
+
+      # Streaming version of #process_split, with the same block contract.
+      # Reads, processes, and writes one chunk at a time, so memory use
+      # depends on +split_size+ rather than the length of the file.
+      #
+      # If +:gain+ is given, the output is multiplied by it and written in a
+      # single pass.  Otherwise the output is spooled to a temporary file and
+      # scaled down if necessary to a peak of 1.0, like #process_split (see
+      # NormalizingOutput).
+      #
+      # Input files are always resampled to 48kHz.
+      def stream_process_split(in_filename, out_filename, split_size, gain: nil, &block)
+        raise 'No block given' unless block_given?
+
+        input = file_input(in_filename)
+        output = nil
+        count = 0
+
+        loop do
+          data = input.read(split_size)
+          frames = data.first.size
+          break if frames == 0
+
+          dfts = data.map { |c| real_fft(MB::M.zpad(c, split_size)) }
+          modified = yield dfts
+          output ||= stream_output(out_filename, modified.size, gain)
+
+          results = modified.map { |c| real_ifft(c, odd_length: split_size.odd?)[0...frames] }
+          write_stream_chunk(output, results, gain)
+
+          count += 1
+        end
+
+        puts "Processed #{count} chunks of size #{split_size}"
+      ensure
+        input&.close
+        output&.close
+      end
+
+      # Streaming version of #process_overlap, with the same block contract.
+      # Keeps only one chunk of input and output in memory, writing each hop
+      # of output as soon as its cross-fade is complete.  See
+      # #stream_process_split for +:gain+.
+      #
+      # Input files are always resampled to 48kHz.
+      def stream_process_overlap(in_filename, out_filename, split_size, overlap_size, gain: nil, &block)
+        raise 'No block given' unless block_given?
+        raise 'Overlap size must be less than split size' unless overlap_size < split_size
+
+        hop_size = split_size - overlap_size
+        fade_in = Numo::SFloat.linspace(0, 1, overlap_size)
+        fade_out = 1 - fade_in
+
+        input = file_input(in_filename)
+        in_bufs = input.channels.times.map { Numo::SFloat.zeros(split_size) }
+        available = read_stream_chunk(input, in_bufs, 0)
+        out_bufs = nil
+        output = nil
+        count = 0
+
+        while available > 0
+          dfts = in_bufs.map { |c| real_fft(c) }
+          modified = yield dfts
+          output ||= stream_output(out_filename, modified.size, gain)
+          out_bufs ||= modified.size.times.map { Numo::SFloat.zeros(split_size) }
+          raise "Channel count changed from #{out_bufs.size} to #{modified.size}" if modified.size != out_bufs.size
+
+          out_bufs.each_with_index do |out, idx|
+            c = real_ifft(modified[idx], odd_length: split_size.odd?)
+
+            if count > 0 && overlap_size > 0
+              # The start of the buffer holds the end of the previous chunk
+              out[0...overlap_size] = out[0...overlap_size] * fade_out + c[0...overlap_size] * fade_in
+              out[overlap_size..-1] = c[overlap_size..-1]
+            else
+              out[] = c
+            end
+          end
+
+          count += 1
+
+          write_stream_chunk(output, out_bufs.map { |c| c[0...[hop_size, available].min] }, gain)
+
+          # Shift by one hop and read the next hop of input
+          if overlap_size > 0
+            out_bufs.each { |c| c[0...overlap_size] = c[hop_size..-1].dup }
+            in_bufs.each { |c| c[0...overlap_size] = c[hop_size..-1].dup }
+          end
+          available = [available - hop_size, 0].max + read_stream_chunk(input, in_bufs, overlap_size)
+        end
+
+        puts "Processed #{count} chunks of size #{split_size} with overlap #{overlap_size}"
+      ensure
+        input&.close
+        output&.close
+      end
+
+      # Out-of-core version of #process for files too large to transform in
+      # memory.  Each channel is transformed by a LargeFFT in scratch files,
+      # then the positive-frequency half of the spectrum is yielded in blocks,
+      # scaled like FFTMethods#real_fft.  The block receives an Array with one
+      # Numo::DComplex per channel and the Range of bins, and must return an
+      # Array of the same number of arrays of the same sizes.  Operations on
+      # individual bins (e.g. reversing via conj, or filtering by frequency)
+      # behave the same as with #process.
+      #
+      # Memory use is limited to roughly +:memory+ bytes per worker, and each
+      # FFT pass uses +:workers+ processes.  Scratch space of about 32 bytes
+      # per sample per channel is needed in the temporary directory.  If the
+      # file's length has no factor near its square root, it is zero-padded to
+      # a length that does (see LargeFFT.good_length) and the output is
+      # truncated to the original length.
+      #
+      # See #stream_process_split for +:gain+.
+      #
+      # Input files are always resampled to 48kHz.
+      #
+      # Example:
+      #     MB::Sound.process_large('sounds/synth0.flac', '/tmp/reverse.flac') do |dfts, range|
+      #       dfts.map(&:conj)
+      #     end
+      def process_large(in_filename, out_filename, gain: nil, memory: LargeFFT::DEFAULT_MEMORY, workers: Etc.nprocessors, &block)
+        raise 'No block given' unless block_given?
+
+        Dir.mktmpdir('mb-sound-large') do |dir|
+          begin
+            source = MappedSample.new(MappedSample.convert(in_filename, File.join(dir, 'input.f32')))
+            frames = source.frames
+            length = LargeFFT.good_length(frames, memory)
+
+            ffts = source.channels.times.map { LargeFFT.new(length, dir: dir, memory: memory, workers: workers) }
+            step = ffts.first.block_size
+
+            (0...frames).step(step) do |offset|
+              data = source.read(offset, [step, frames - offset].min)
+              ffts.each_with_index { |f, idx| f.write(offset, data[idx]) }
+            end
+            source.close
+
+            ffts.each(&:forward!)
+
+            scale = 2.0 / length
+            bins = length / 2 + 1
+            (0...bins).step(step) do |offset|
+              range = offset...[offset + step, bins].min
+              dfts = ffts.map { |f| f.read(offset, range.size).inplace * scale }
+              modified = yield dfts.map(&:not_inplace!), range
+
+              raise "Processing block returned #{modified.size} channels instead of #{ffts.size}" unless modified.size == ffts.size
+              ffts.each_with_index do |f, idx|
+                raise "Processing block changed the size of channel #{idx}" unless modified[idx].size == range.size
+                f.write(offset, modified[idx] * (1.0 / scale))
+              end
+            end
+
+            ffts.each do |f|
+              f.make_hermitian!
+              f.inverse!
+            end
+
+            output = stream_output(out_filename, ffts.size, gain)
+            (0...frames).step(step) do |offset|
+              count = [step, frames - offset].min
+              write_stream_chunk(output, ffts.map { |f| Numo::SFloat.cast(f.read(offset, count).real) }, gain)
+            end
+          ensure
+            output&.close
+            ffts&.each(&:close)
+            source&.close
+          end
+        end
+      end
+
       # Processes audio using overlapping cross-fades, from an +input_stream+ that
       # can return a requested number of frames (specifically +hop_size+) as an
       # array of Numo::SFloat arrays.  Writes audio to +output_stream+ as an array
@@ -189,7 +388,7 @@ module MB
         output = []
 
         if overlap_size > 1
-          fade_in = MB::M.opad(linear_fade(0, 1, overlap_size), split_size)
+          fade_in = MB::M.opad(Numo::SFloat.linspace(0, 1, overlap_size), split_size)
           fade_out = 1 - fade_in
         end
 
@@ -431,6 +630,35 @@ module MB
 
         fft_writer.drain
       end
+
+      private
+
+      # Returns an output stream for the streaming process methods: a file
+      # output if a fixed +gain+ is given, or a NormalizingOutput otherwise.
+      def stream_output(out_filename, channels, gain)
+        output = file_output(out_filename, channels: channels)
+        gain ? output : NormalizingOutput.new(output)
+      end
+
+      # Writes +data+ to +output+, multiplied by +gain+ if given.
+      def write_stream_chunk(output, data, gain)
+        data = data.map { |c| c * gain } if gain
+        output.write(data)
+      end
+
+      # Fills +bufs+ from +input+ starting at +offset+, zeroing anything past
+      # the end of the input.  Returns the number of frames read.
+      def read_stream_chunk(input, bufs, offset)
+        data = input.read(bufs.first.size - offset)
+        frames = data.first.size
+
+        bufs.each_with_index do |c, idx|
+          c[offset...(offset + frames)] = data[idx] if frames > 0
+          c[(offset + frames)..-1] = 0 if offset + frames < c.size
+        end
+
+        frames
+      end
     end
   end
 end
@@ -23,6 +23,13 @@ module MB
         @zero = [Numo::SFloat.zeros(@hop)] * input_stream.channels
       end
 
+      # Returns the number of samples by which audio read through this
+      # reader (and written back out with a WindowWriter) is delayed, which
+      # is the overlap between windows.
+      def latency
+        @overlap
+      end
+
       # Reads one overlapped window of data.  If the stream returns less than the
       # hop length, then zeros will be appended for the current read, and all
       # zeros returned for subsequent reads until the next read would return only
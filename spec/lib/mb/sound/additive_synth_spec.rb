@@ -0,0 +1,94 @@
+RSpec.describe(MB::Sound::AdditiveSynth) do
+  let(:output) { MB::Sound::SpecSupport::CollectingOutput.new(channels: 1, buffer_size: 256) }
+
+  # Returns the sum of cosines at the given frequencies and amplitudes, with
+  # zero phase at sample +origin+.
+  def reference(freqs, amps, length, origin: 0)
+    t = (Numo::DFloat.new(1, length).seq - origin) * (2.0 * Math::PI / 48000)
+    (Numo::NMath.cos(Numo::DFloat.cast(freqs).reshape(freqs.length, 1) * t) * Numo::DFloat.cast(amps).reshape(amps.length, 1)).sum(axis: 0)
+  end
+
+  describe '#write' do
+    it 'renders a few partials directly with continuous phase' do
+      synth = MB::Sound::AdditiveSynth.new(output)
+      freqs = Numo::DFloat[100, 1234.5, 5000]
+      amps = Numo::DFloat[0.5, 0.25, 0.125]
+
+      synth.write(freqs, amps * 0)
+      10.times { synth.write(freqs, amps) }
+      expect(synth.mode).to eq(:direct)
+
+      # The first hop with sound ramps up from silence
+      result = output.audio[512..-1]
+      ref = reference(freqs, amps, 2816)[512..-1]
+      expect((result - ref).abs.max).to be < 1e-5
+    end
+
+    it 'ramps amplitudes across each hop in direct mode' do
+      synth = MB::Sound::AdditiveSynth.new(output, mode: :direct)
+      synth.write([0.001], [0])
+      synth.write([0.001], [1])
+
+      ramp = output.audio[256..-1]
+      expect(ramp[0].round(6)).to eq(0)
+      expect(ramp[128].round(3)).to eq(0.5)
+    end
+
+    it 'renders many partials with the inverse FFT method' do
+      synth = MB::Sound::AdditiveSynth.new(output)
+      freqs = Numo::DFloat.new(200).rand(50, 20000)
+      amps = Numo::DFloat.ones(200) / 200
+
+      40.times { synth.write(freqs, amps) }
+      expect(synth.mode).to eq(:ifft)
+      expect(synth.latency).to eq(512)
+
+      # Each frame's phases are given at its center
+      result = output.audio
+      ref = reference(freqs, amps, result.length, origin: 512)
+      expect((result[1024..-1] - ref[1024..-1]).abs.max).to be < 0.01
+    end
+
+    it 'silences partials above Nyquist' do
+      synth = MB::Sound::AdditiveSynth.new(output, mode: :direct)
+      4.times { synth.write([30000, -5], [1, 1]) }
+      expect(output.audio.abs.max).to eq(0)
+    end
+
+    it 'accepts explicit phases' do
+      synth = MB::Sound::AdditiveSynth.new(output, mode: :direct)
+      synth.write([1000], [1])
+      synth.write([1000], [1], [Math::PI / 2])
+      expect(output.audio[256].round(5)).to eq(0)
+      expect(output.audio[268].round(5)).to eq(-1)
+    end
+
+    it 'raises an error for mismatched lengths' do
+      synth = MB::Sound::AdditiveSynth.new(output)
+      expect { synth.write([1, 2], [1]) }.to raise_error(/same length/)
+    end
+  end
+
+  describe '#spectrum' do
+    it 'places a partial at the right bin' do
+      synth = MB::Sound::AdditiveSynth.new(output)
+      spectrum = synth.spectrum(Numo::DFloat[4687.5], Numo::DFloat[1], Numo::DFloat[0])
+      expect(spectrum.abs.max_index).to eq(100)
+    end
+
+    it 'folds partials near DC into positive frequencies' do
+      synth = MB::Sound::AdditiveSynth.new(output)
+      spectrum = synth.spectrum(Numo::DFloat[20], Numo::DFloat[1], Numo::DFloat[0])
+      frame = MB::Sound.real_ifft(spectrum)
+      hann = 1 - Numo::NMath.cos(Numo::DFloat.new(1024).seq * (2 * Math::PI / 1024))
+      expected = hann * Numo::NMath.cos((Numo::DFloat.new(1024).seq - 512) * (2 * Math::PI * 20 / 48000))
+      expect((frame - expected).abs.max).to be < 0.02
+    end
+  end
+
+  describe '#initialize' do
+    it 'requires a hop that divides half the FFT size' do
+      expect { MB::Sound::AdditiveSynth.new(output, fft_size: 1024, hop: 300) }.to raise_error(/Hop/)
+    end
+  end
+end
@@ -0,0 +1,30 @@
+RSpec.describe(MB::Sound::ArrayInput) do
+  let(:data) { [Numo::SFloat[1, 2, 3, 4, 5], Numo::SFloat[-1, -2, -3, -4, -5]] }
+  let(:input) { MB::Sound::ArrayInput.new(data) }
+
+  describe '#initialize' do
+    it 'accepts a single NArray as one channel' do
+      expect(MB::Sound::ArrayInput.new(Numo::SFloat[1, 2, 3]).channels).to eq(1)
+    end
+
+    it 'raises an error if channels have different lengths' do
+      expect { MB::Sound::ArrayInput.new([Numo::SFloat[1], Numo::SFloat[1, 2]]) }.to raise_error(/length/)
+    end
+  end
+
+  describe '#read' do
+    it 'returns the data in order, then empty arrays' do
+      expect(input.read(3)).to eq([Numo::SFloat[1, 2, 3], Numo::SFloat[-1, -2, -3]])
+      expect(input.read(3)).to eq([Numo::SFloat[4, 5], Numo::SFloat[-4, -5]])
+      expect(input.read(3).map(&:length)).to eq([0, 0])
+      expect(input.remaining).to eq(0)
+    end
+  end
+
+  describe '#close' do
+    it 'prevents further reading' do
+      input.close
+      expect { input.read(1) }.to raise_error(/closed/)
+    end
+  end
+end
@@ -0,0 +1,71 @@
+RSpec.describe(MB::Sound::BinauralRenderer) do
+  # Direct convolution for comparison, truncated to the input length
+  def convolve(x, h)
+    out = Numo::DFloat.zeros(x.length)
+    h.length.times do |i|
+      out[i..-1] += x[0...(x.length - i)] * h[i] if i < x.length
+    end
+    out
+  end
+
+  let(:hrirs) {
+    {
+      30.degrees => [Numo::DFloat.new(10).rand(-1, 1), Numo::DFloat.new(10).rand(-1, 1)],
+      -30.degrees => [Numo::DFloat.new(7).rand(-1, 1), Numo::DFloat.new(9).rand(-1, 1)],
+    }
+  }
+
+  let(:renderer) { MB::Sound::BinauralRenderer.new(hrirs, directions: [30.degrees, -30.degrees], block_size: 4) }
+
+  it 'partitions the HRIRs into blocks' do
+    expect(renderer.partitions).to eq(3)
+    expect(renderer.latency).to eq(4)
+    expect(renderer.channels).to eq(2)
+  end
+
+  it 'matches direct convolution, delayed by one block' do
+    input = [Numo::SFloat.new(37).rand(-1, 1), Numo::SFloat.new(37).rand(-1, 1)]
+
+    # Process in uneven chunks, then flush the latency
+    out = [[], []]
+    [[0, 5], [5, 3], [8, 11], [19, 18]].each do |start, count|
+      result = renderer.process(input.map { |c| c[start...(start + count)] })
+      out.each_with_index { |o, ear| o.concat(result[ear].to_a) }
+    end
+    result = renderer.process([Numo::SFloat.zeros(4)] * 2)
+    out.each_with_index { |o, ear| o.concat(result[ear].to_a) }
+
+    2.times do |ear|
+      expected = convolve(Numo::DFloat.cast(input[0]), hrirs[30.degrees][ear]) +
+        convolve(Numo::DFloat.cast(input[1]), hrirs[-30.degrees][ear])
+      expect(MB::M.round(Numo::DFloat.cast(out[ear][4..-1]), 4)).to eq(MB::M.round(expected, 4))
+      expect(MB::M.round(Numo::DFloat.cast(out[ear][0...4]), 6).to_a).to eq([0, 0, 0, 0])
+    end
+  end
+
+  it 'uses the nearest HRIR and crossfades when a direction changes' do
+    mono = MB::Sound::BinauralRenderer.new(
+      { 0 => [Numo::DFloat[1], Numo::DFloat[0]], Math::PI => [Numo::DFloat[0], Numo::DFloat[1]] },
+      directions: [10.degrees],
+      block_size: 4
+    )
+
+    left, right = mono.process([Numo::SFloat.ones(8)])
+    expect(MB::M.round(left, 6).to_a).to eq([0, 0, 0, 0, 1, 1, 1, 1])
+    expect(MB::M.round(right, 6).to_a).to eq([0] * 8)
+
+    mono.directions = [170.degrees]
+    expect(mono.directions).to eq([170.degrees])
+    left, right = mono.process([Numo::SFloat.ones(8)])
+
+    # The first block is already rendered; the second fades from left to right
+    expect(MB::M.round(left[0...4], 6).to_a).to eq([1, 1, 1, 1])
+    expect(left[4..-1].diff.max).to be < 0
+    expect(right[4..-1].diff.min).to be > 0
+    expect(MB::M.round(left + right, 6).to_a).to eq([1] * 8)
+  end
+
+  it 'raises an error if given the wrong number of channels' do
+    expect { renderer.process([Numo::SFloat.zeros(4)]) }.to raise_error(ArgumentError, /channels/)
+  end
+end
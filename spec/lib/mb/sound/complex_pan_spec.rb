@@ -24,6 +24,75 @@ RSpec.describe(MB::Sound::ComplexPan) do
 
       expect(MB::M.round(f45.process(data), 6)).to eq(MB::M.round(expected, 6))
     end
+
+    it 'can automate pan per sample with an NArray' do
+      f6 = MB::Sound::ComplexPan.new(center_gain: MB::Sound::ComplexPan::DB_6)
+      f6.pan = Numo::DFloat[-1, 0, 1]
+      l, r = f6.process(Numo::SFloat[1, 1, 1])
+
+      expect(l).to be_a(Numo::SComplex)
+      expect(l.real.to_a).to eq([1, 0.5, 0])
+      expect(r.real.to_a).to eq([0, 0.5, 1])
+    end
+
+    it 'can automate phase per sample with an NArray' do
+      f45.phase = Numo::DFloat[0, 180.degrees]
+      l, r = f45.process(Numo::SFloat[1, 1])
+
+      expect(l).to be_a(Numo::SComplex)
+      expect(MB::M.round((l * r.conj).arg.abs, 5).to_a).to eq([0, MB::M.round(Math::PI, 5)])
+    end
+
+    it 'holds the last automation value for later buffers' do
+      f6 = MB::Sound::ComplexPan.new(center_gain: MB::Sound::ComplexPan::DB_6)
+      f6.pan = Numo::DFloat[-1, 0, 1]
+      f6.process(Numo::SFloat[1, 1, 1])
+
+      expect(f6.pan).to eq(1)
+      l, r = f6.process(Numo::SFloat[1, 1, 1, 1])
+      expect(l.real.to_a).to eq([0, 0, 0, 0])
+      expect(r.real.to_a).to eq([1, 1, 1, 1])
+    end
+
+    it 'raises an error if the automation length does not match the data' do
+      f45.pan = Numo::DFloat[0, 1]
+      expect { f45.process(Numo::SFloat[1, 2, 3]) }.to raise_error(ArgumentError, /samples/)
+    end
+
+    context 'with smoothing' do
+      let(:smooth) { MB::Sound::ComplexPan.new(center_gain: MB::Sound::ComplexPan::DB_6, rate: 1000, smoothing: 0.01) }
+
+      it 'glides toward a new pan value across the buffer' do
+        smooth.pan = 1
+        l, r = smooth.process(Numo::SFloat.ones(100)).map(&:real)
+
+        expect(r[0]).to be_between(0.5, 0.6)
+        expect(r.diff.min).to be >= 0
+        expect(r[-1]).to be_within(1e-4).of(1)
+        expect(l[-1]).to be_within(1e-4).of(0)
+      end
+
+      it 'continues smoothly into the next buffer' do
+        smooth.pan = 1
+        _, r1 = smooth.process(Numo::SFloat.ones(5)).map(&:real)
+        _, r2 = smooth.process(Numo::SFloat.ones(5)).map(&:real)
+        expect(r2[0]).to be > r1[-1]
+        expect(r2[0] - r1[-1]).to be < r1[-1] - r1[-2]
+      end
+
+      it 'returns the same type while gliding and after settling' do
+        smooth.pan = 1
+        types = 10.times.map { smooth.process(Numo::SFloat.ones(100)).map(&:class) }
+        expect(types.uniq).to eq([[Numo::SComplex, Numo::SComplex]])
+      end
+
+      it 'jumps to the target value when reset' do
+        smooth.pan = 1
+        smooth.reset
+        _, r = smooth.process(Numo::SFloat.ones(3))
+        expect(r.to_a).to eq([1, 1, 1])
+      end
+    end
   end
 
   describe '.gains' do
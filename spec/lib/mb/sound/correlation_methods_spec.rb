@@ -0,0 +1,75 @@
+RSpec.describe(MB::Sound::CorrelationMethods) do
+  let(:noise) { Numo::SFloat.zeros(48000).rand(-1, 1) }
+  let(:delayed) { Numo::SFloat.zeros(1234).concatenate(noise * 0.5)[0...48000] }
+
+  describe '#cross_correlate' do
+    it 'has a peak at the lag of the delayed signal' do
+      r = MB::Sound.cross_correlate(noise[0...1000], delayed[0...2000], max_lag: 1500)
+      expect(r.length).to eq(3001)
+      expect(r.max_index - 1500).to eq(1234)
+    end
+
+    it 'has a negative lag when the second signal is early' do
+      r = MB::Sound.cross_correlate(delayed[0...2000], noise[0...1000], max_lag: 1500)
+      expect(r.max_index - 1500).to eq(-1234)
+    end
+
+    it 'matches direct computation' do
+      a = Numo::DFloat[1, 2, 3]
+      b = Numo::DFloat[0, 1, -1]
+      r = MB::Sound.cross_correlate(a, b, max_lag: 2)
+      expect(MB::M.round(r, 6)).to eq(Numo::DFloat[0, 3, -1, -1, -1])
+    end
+
+    it 'has a peak of 1 for identical signals with PHAT weighting' do
+      r = MB::Sound.cross_correlate(noise[0...4096], noise[0...4096], max_lag: 100, phat: true)
+      expect(r.max_index).to eq(100)
+      expect(r.max.round(4)).to eq(1)
+    end
+  end
+
+  describe '#find_offset' do
+    it 'finds the offset of a delayed signal' do
+      expect(MB::Sound.find_offset(noise, delayed, max_lag: 4800, refine_length: 4800)).to eq(1234)
+    end
+
+    it 'finds a negative offset' do
+      expect(MB::Sound.find_offset(delayed, noise, max_lag: 4800, refine_length: 4800)).to eq(-1234)
+    end
+
+    it 'finds a negative offset longer than the refinement excerpt' do
+      long_noise = Numo::SFloat.zeros(40000).rand(-1, 1)
+      long_delayed = Numo::SFloat.zeros(24000).concatenate(long_noise * 0.5)
+      offset = MB::Sound.find_offset(long_delayed, long_noise, max_lag: 32000, refine_length: 8000, rate: 8000)
+      expect(offset).to eq(-24000)
+    end
+
+    it 'mixes multichannel sources to mono' do
+      expect(MB::Sound.find_offset([noise, noise], [delayed, delayed], max_lag: 4800)).to eq(1234)
+    end
+
+    it 'can estimate sub-sample offsets' do
+      half = (noise + MB::M.rol(noise, -1)) / 2
+      offset = MB::Sound.find_offset(noise, half, max_lag: 100, decimation: 4, subsample: true)
+      expect(offset).to be_a(Float)
+      expect(offset).to be_between(0.3, 0.7)
+    end
+  end
+
+  describe '#find_offsets' do
+    it 'returns offsets relative to the first source' do
+      offsets = MB::Sound.find_offsets([delayed, noise, delayed], max_lag: 4800)
+      expect(offsets).to eq([0, -1234, 0])
+    end
+  end
+
+  describe '#align_inputs' do
+    it 'skips leading audio so inputs line up' do
+      inputs = [MB::Sound::ArrayInput.new(noise), MB::Sound::ArrayInput.new(delayed)]
+      inputs = MB::Sound.align_inputs(inputs, [0, 1234])
+      a = inputs[0].read(1000)[0]
+      b = inputs[1].read(1000)[0]
+      expect(MB::M.round(b, 5)).to eq(MB::M.round(a * 0.5, 5))
+    end
+  end
+end
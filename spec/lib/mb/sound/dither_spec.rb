@@ -0,0 +1,75 @@
+RSpec.describe(MB::Sound::Dither) do
+  let(:data) { Numo::SFloat.new(10000).rand(-0.5, 0.5) }
+
+  it 'returns integers of the requested size' do
+    expect(MB::Sound::Dither.new(bits: 16).process(data)).to be_a(Numo::Int16)
+    expect(MB::Sound::Dither.new(bits: 24).process(data)).to be_a(Numo::Int32)
+    expect(MB::Sound::Dither.new(bits: 32).process([data, data])[1]).to be_a(Numo::Int32)
+  end
+
+  it 'stays within one or two LSBs of the input' do
+    err = MB::Sound::Dither.new(bits: 16).process(data) - Numo::DFloat.cast(data) * 32768
+    expect(err.abs.max).to be <= 1.5
+  end
+
+  it 'clips to the integer range' do
+    result = MB::Sound::Dither.new(bits: 24).process(Numo::SFloat[-2, 2, 1])
+    expect(result.to_a).to eq([-8388608, 8388607, 8388607])
+  end
+
+  it 'averages to values between integer steps' do
+    result = MB::Sound::Dither.new(bits: 16, seed: 3).process(Numo::SFloat.zeros(20000).fill(0.25 / 32768))
+    expect(result.to_a.uniq.length).to be > 1
+    expect(Numo::DFloat.cast(result).mean).to be_within(0.02).of(0.25)
+  end
+
+  it 'is reproducible with a seed' do
+    a = MB::Sound::Dither.new(seed: 42).process([data, data])
+    b = MB::Sound::Dither.new(seed: 42).process([data, data])
+    c = MB::Sound::Dither.new(seed: 43).process([data, data])
+    expect(a).to eq(b)
+    expect(a).not_to eq(c)
+    expect(a[0]).not_to eq(a[1])
+  end
+
+  it 'does not change the sequence of Numo random values' do
+    Numo::NArray.srand(5)
+    expected = Numo::DFloat.new(5).rand
+
+    Numo::NArray.srand(5)
+    MB::Sound::Dither.new(seed: 1).process([Numo::SFloat.zeros(100)] * 2)
+    expect(Numo::DFloat.new(5).rand).to eq(expected)
+  end
+
+  it 'can pack interleaved samples' do
+    d = MB::Sound::Dither.new(bits: 16)
+    bytes = d.pack([Numo::Int16[1, 2], Numo::Int16[3, 4]])
+    expect(bytes.unpack('s*')).to eq([1, 3, 2, 4])
+  end
+
+  [:highpass, :error_feedback].each do |shaping|
+    context "with #{shaping} shaping" do
+      it 'has less low-frequency noise than flat dither' do
+        x = Numo::DFloat.cast(data) * 32768
+        flat = Numo::DFloat.cast(MB::Sound::Dither.new(seed: 1).process(data)) - x
+        shaped = Numo::DFloat.cast(MB::Sound::Dither.new(shaping: shaping, seed: 1).process(data)) - x
+
+        # Compare the error averaged over 100-sample blocks
+        expect((shaped.reshape(100, 100).mean(axis: 1) ** 2).sum).to be < (flat.reshape(100, 100).mean(axis: 1) ** 2).sum
+      end
+
+      it 'continues shaping across buffers' do
+        d = MB::Sound::Dither.new(shaping: shaping, seed: 1)
+        x = Numo::DFloat.cast(data) * 32768
+        result = d.process(data[0...5000]).concatenate(d.process(data[5000..-1]))
+        expect((Numo::DFloat.cast(result) - x).abs.max).to be <= 3
+      end
+    end
+  end
+
+  it 'keeps the total error bounded with error feedback' do
+    x = Numo::DFloat.cast(data) * 32768
+    err = Numo::DFloat.cast(MB::Sound::Dither.new(shaping: :error_feedback).process(data)) - x
+    expect(err.sum.abs).to be < 2
+  end
+end
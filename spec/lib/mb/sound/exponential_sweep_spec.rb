@@ -0,0 +1,72 @@
+require 'benchmark'
+
+RSpec.describe(MB::Sound::ExponentialSweep) do
+  let(:sweep) { MB::Sound::ExponentialSweep.new(duration: 1) }
+
+  describe '#sweep' do
+    it 'has the expected length and amplitude' do
+      expect(sweep.sweep.length).to eq(48000)
+      expect(sweep.sweep.abs.max.round(2)).to eq(0.5)
+    end
+
+    it 'fades in and out' do
+      expect(sweep.sweep[0]).to eq(0)
+      expect(sweep.sweep[-1].abs).to be < 0.001
+    end
+  end
+
+  describe '#deconvolve' do
+    it 'recovers an impulse from the unmodified sweep' do
+      ir = sweep.deconvolve(sweep.sweep, length: 1000, pre: 100, block_size: 4096)
+      expect(ir.length).to eq(1)
+      expect(ir[0].length).to eq(1100)
+      expect(ir[0].abs.max_index).to eq(100)
+    end
+
+    it 'has unity gain in the swept band' do
+      ir = sweep.deconvolve(sweep.sweep, length: 2048, pre: 2048)[0]
+      spectrum = MB::Sound.real_fft(ir).abs * ir.length / 2
+      hz_per_bin = 48000.0 / ir.length
+      [100, 1000, 10000].each do |f|
+        expect(spectrum[(f / hz_per_bin).round].to_db.round(1)).to eq(0)
+      end
+    end
+
+    it 'recovers the delay and gain of a system' do
+      recording = Numo::SFloat.zeros(1000).concatenate(sweep.sweep * 0.5)
+      reference = sweep.deconvolve(sweep.sweep, length: 2000)[0]
+      ir = sweep.deconvolve([recording, recording * -1], length: 2000)
+      expect(ir.length).to eq(2)
+      expect(ir[0].abs.max_index).to eq(1000)
+      expect(ir[0][1000].round(3)).to eq((reference[0] * 0.5).round(3))
+      expect(ir[1][1000].round(3)).to eq((reference[0] * -0.5).round(3))
+    end
+
+    it 'accepts an input stream' do
+      input = MB::Sound::ArrayInput.new([sweep.sweep], buffer_size: 512)
+      expect(sweep.deconvolve(input, length: 10)[0].abs.max_index).to eq(0)
+    end
+
+    it 'deconvolves a 30 second sweep in well under a second' do
+      long = MB::Sound::ExponentialSweep.new(duration: 30)
+      long.inverse
+      elapsed = Benchmark.realtime { long.deconvolve(long.sweep, length: 48000) }
+      expect(elapsed).to be < 1
+    end
+  end
+
+  describe '#write' do
+    it 'writes the whole sweep to an output' do
+      output = MB::Sound::NullOutput.new(channels: 2, buffer_size: 1000, sleep: false)
+      expect(output).to receive(:write).exactly(48).times.and_call_original
+      sweep.write(output)
+    end
+  end
+
+  it 'produces an impulse response usable by the FIR filter' do
+    ir = sweep.deconvolve(sweep.sweep, length: 500)[0]
+    filter = MB::Sound::Filter::FIR.from_impulse(ir)
+    expect(filter.filter_length).to eq(500)
+    expect(filter.impulse).to eq(ir)
+  end
+end
@@ -0,0 +1,99 @@
+RSpec.describe(MB::Sound::FDNReverb) do
+  let(:impulse) { Numo::SFloat.zeros(48000).tap { |d| d[0] = 1 } }
+  let(:silence) { Numo::SFloat.zeros(48000) }
+
+  describe '#initialize' do
+    it 'chooses distinct prime delay lengths' do
+      reverb = MB::Sound::FDNReverb.new(lines: 16)
+      expect(reverb.delays.length).to eq(16)
+      expect(reverb.delays.uniq.length).to eq(16)
+      expect(reverb.delays.all? { |d| (2..Math.sqrt(d)).none? { |f| d % f == 0 } }).to eq(true)
+    end
+
+    it 'scales delay lengths by size' do
+      small = MB::Sound::FDNReverb.new(size: 0.5)
+      large = MB::Sound::FDNReverb.new(size: 2)
+      expect(large.delays.min).to be > small.delays.max
+    end
+
+    it 'accepts custom delays' do
+      reverb = MB::Sound::FDNReverb.new(lines: 4, delays: [101, 113, 127, 139])
+      expect(reverb.delays).to eq([101, 113, 127, 139])
+    end
+
+    it 'raises an error for invalid parameters' do
+      expect { MB::Sound::FDNReverb.new(lines: 6) }.to raise_error(/power of two/)
+      expect { MB::Sound::FDNReverb.new(matrix: :random) }.to raise_error(/Matrix/)
+      expect { MB::Sound::FDNReverb.new(damping: 1) }.to raise_error(/Damping/)
+      expect { MB::Sound::FDNReverb.new(lines: 4, delays: [1, 2]) }.to raise_error(/Expected 4/)
+    end
+  end
+
+  describe '#process' do
+    it 'passes the dry signal through before the first delay' do
+      reverb = MB::Sound::FDNReverb.new(dry: 0.5)
+      result = reverb.process([impulse, impulse])
+      first = reverb.delays.min
+
+      expect(result[0][0]).to eq(0.5)
+      expect(result[0][1...first].abs.max).to eq(0)
+      expect(result[0][first..-1].abs.max).to be > 0
+    end
+
+    it 'produces decorrelated stereo output from mono input' do
+      reverb = MB::Sound::FDNReverb.new(dry: 0)
+      left, right = reverb.process([impulse, impulse])
+      correlation = (left * right).sum / Math.sqrt((left ** 2).sum * (right ** 2).sum)
+      expect(correlation.abs).to be < 0.5
+    end
+
+    [:householder, :hadamard].each do |matrix|
+      it "decays by about 60dB in rt60 seconds with a #{matrix} matrix" do
+        reverb = MB::Sound::FDNReverb.new(rt60: 0.5, damping: 0, dry: 0, matrix: matrix)
+        result = reverb.process([impulse, impulse])[0]
+
+        early = Math.sqrt((result[2400...7200] ** 2).mean)
+        late = Math.sqrt((result[26400...31200] ** 2).mean)
+        expect(MB::M.db(late / early)).to be_between(-70, -50)
+      end
+    end
+
+    it 'loses no energy with no damping and a very long decay' do
+      reverb = MB::Sound::FDNReverb.new(channels: 1, lines: 4, delays: [101, 113, 127, 139], rt60: 1e9, damping: 0, dry: 0)
+      reverb.process([impulse[0...1000]])
+
+      # With an orthogonal matrix the energy stored in the lines is constant,
+      # so the output keeps ringing at a steady level.
+      first = reverb.process([silence[0...4000]])[0].dup
+      second = reverb.process([silence[0...4000]])[0]
+      expect((second ** 2).sum / (first ** 2).sum).to be_between(0.9, 1.1)
+    end
+
+    it 'removes more high frequencies with more damping' do
+      bright = MB::Sound::FDNReverb.new(channels: 1, damping: 0, dry: 0).process([impulse])[0]
+      dark = MB::Sound::FDNReverb.new(channels: 1, damping: 0.7, dry: 0).process([impulse])[0]
+
+      hf = ->(d) { (d[1..-1] - d[0...-1]).abs.sum / d.abs.sum }
+      expect(hf.(dark)).to be < hf.(bright) * 0.5
+    end
+
+    it 'gives the same result regardless of buffer size' do
+      data = Numo::SFloat.new(10000).rand(-1, 1)
+
+      whole = MB::Sound::FDNReverb.new(channels: 1).process([data])[0].dup
+
+      reverb = MB::Sound::FDNReverb.new(channels: 1)
+      pieces = (0...10000).step(777).map { |s| reverb.process([data[s...[s + 777, 10000].min]])[0].dup }
+
+      expect(MB::M.round(pieces.reduce(&:concatenate), 5)).to eq(MB::M.round(whole, 5))
+    end
+
+    it 'can be reset' do
+      reverb = MB::Sound::FDNReverb.new
+      first = reverb.process([impulse, impulse])[0].dup
+      reverb.process([impulse, impulse])
+      reverb.reset
+      expect(reverb.process([impulse, impulse])[0]).to eq(first)
+    end
+  end
+end
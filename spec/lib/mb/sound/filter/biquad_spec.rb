@@ -75,6 +75,51 @@ RSpec.describe(MB::Sound::Filter::Biquad) do
     end
   end
 
+  describe '#process' do
+    let(:input) { Numo::DFloat.new(5000).rand(-1, 1) }
+    let(:f) { MB::Sound::Filter::Cookbook.new(:peak, 48000, 200, quality: 4, db_gain: 12) }
+    let(:g) { MB::Sound::Filter::Cookbook.new(:peak, 48000, 200, quality: 4, db_gain: 12) }
+
+    # The sample-by-sample Direct Form I result, for comparison
+    let(:expected) { input.to_a.map { |v| g.process([v])[0] } }
+
+    it 'gives the same result for arrays as for individual samples' do
+      expect(MB::M.round(f.process(input), 9).to_a).to eq(MB::M.round(Numo::DFloat.cast(expected), 9).to_a)
+    end
+
+    it 'carries state between arrays' do
+      result = Numo::DFloat.zeros(input.length)
+      [0...700, 700...710, 710...3000, 3000...5000].each do |range|
+        result[range] = f.process(input[range].dup)
+      end
+      expect(MB::M.round(result, 9).to_a).to eq(MB::M.round(Numo::DFloat.cast(expected), 9).to_a)
+    end
+
+    it 'can process arrays in place' do
+      data = input.dup.inplace!
+      result = f.process(data)
+      expect(result).to equal(data)
+      expect(MB::M.round(result.not_inplace!, 9).to_a).to eq(MB::M.round(Numo::DFloat.cast(expected), 9).to_a)
+    end
+
+    it 'preserves single precision arrays' do
+      expect(f.process(Numo::SFloat.cast(input))).to be_a(Numo::SFloat)
+    end
+
+    it 'flushes decaying state to exact zeros sample by sample' do
+      f.process([1.0])
+      result = f.process([0.0] * 48000)
+      expect(result[0]).not_to eq(0)
+      expect(result.last(100)).to all(eq(0))
+    end
+
+    it 'flushes decaying state to exact zeros between blocks' do
+      f.process(Numo::DFloat[1])
+      f.process(Numo::DFloat.zeros(48000))
+      expect(f.process(Numo::DFloat.zeros(2000)).abs.max).to eq(0)
+    end
+  end
+
   describe '#z_response' do
     it 'returns the same value as #response for values on the unit circle' do
       f = MB::Sound::Filter::Cookbook.new(:lowpass, 48000, 12000, quality: 0.5 ** 0.5)
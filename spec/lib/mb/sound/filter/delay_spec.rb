@@ -0,0 +1,129 @@
+RSpec.describe(MB::Sound::Filter::Delay) do
+  let(:impulse) { Numo::SFloat.zeros(16).tap { |d| d[0] = 1 } }
+
+  describe '#process' do
+    it 'delays by whole samples' do
+      delay = MB::Sound::Filter::Delay.new(delay: 3, interpolation: :none)
+      result = delay.process(impulse)
+      expect(result.max_index).to eq(3)
+      expect(result.sum).to eq(1)
+    end
+
+    it 'delays across multiple blocks' do
+      delay = MB::Sound::Filter::Delay.new(delay: 10, buffer_size: 4)
+      result = 4.times.map { |i| delay.process(impulse[(i * 4)...((i + 1) * 4)]).dup }
+      expect(result.reduce(&:concatenate)).to eq(MB::M.rol(impulse, -10))
+    end
+
+    it 'splits blocks longer than the buffer size' do
+      delay = MB::Sound::Filter::Delay.new(delay: 5, buffer_size: 3)
+      expect(delay.process(impulse)).to eq(MB::M.rol(impulse, -5))
+    end
+
+    it 'can process single samples' do
+      delay = MB::Sound::Filter::Delay.new(delay: 1)
+      expect(delay.process(1)).to eq(0)
+      expect(delay.process(0)).to eq(1)
+    end
+
+    it 'interpolates linearly between samples' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2.25)
+      result = delay.process(impulse)
+      expect(MB::M.round(result[0..4], 5)).to eq(Numo::SFloat[0, 0, 0.75, 0.25, 0])
+    end
+
+    it 'interpolates using Lagrange polynomials' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2.5, interpolation: :lagrange)
+      result = delay.process(impulse)
+      expect(MB::M.round(result[0..5], 5)).to eq(Numo::SFloat[0, -0.0625, 0.5625, 0.5625, -0.0625, 0])
+    end
+
+    it 'is exact for whole-sample Lagrange delays' do
+      delay = MB::Sound::Filter::Delay.new(delay: 4, interpolation: :lagrange)
+      expect(MB::M.round(delay.process(impulse), 5)).to eq(MB::M.rol(impulse, -4))
+    end
+
+    it 'is exact for whole-sample allpass delays' do
+      delay = MB::Sound::Filter::Delay.new(delay: 4, interpolation: :allpass)
+      expect(MB::M.round(delay.process(impulse), 5)).to eq(MB::M.rol(impulse, -4))
+    end
+
+    it 'has unity gain for fractional allpass delays' do
+      delay = MB::Sound::Filter::Delay.new(delay: 3.3, interpolation: :allpass)
+      result = delay.process(Numo::SFloat.zeros(400).tap { |d| d[0] = 1 })
+      expect(result.sum.round(4)).to eq(1)
+      expect((result ** 2).sum.round(4)).to eq(1)
+      expect(result[0..1]).to eq(Numo::SFloat.zeros(2))
+    end
+
+    it 'delays multiple channels' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2, channels: 2)
+      result = delay.process([impulse, impulse * -2])
+      expect(result.length).to eq(2)
+      expect(result[0]).to eq(MB::M.rol(impulse, -2))
+      expect(result[1]).to eq(MB::M.rol(impulse * -2, -2))
+    end
+
+    it 'accepts two-dimensional NArrays' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2, channels: 2)
+      result = delay.process(Numo::SFloat[[1, 2, 3, 4], [5, 6, 7, 8]])
+      expect(result).to eq(Numo::SFloat[[0, 0, 1, 2], [0, 0, 5, 6]])
+    end
+
+    it 'accepts a modulated delay' do
+      delay = MB::Sound::Filter::Delay.new(delay: Numo::SFloat[0, 1, 2, 3], max_delay: 3)
+      expect(delay.process(Numo::SFloat[1, 2, 3, 4])).to eq(Numo::SFloat[1, 1, 1, 1])
+    end
+
+    it 'reuses its output buffer' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2)
+      a = delay.process(impulse)
+      b = delay.process(impulse)
+      expect(b).to eq(MB::M.rol(impulse, -2).tap { |d| d[0] = 0 })
+      expect(a).to eq(b)
+    end
+  end
+
+  describe '#read' do
+    it 'can read multiple taps from one write' do
+      delay = MB::Sound::Filter::Delay.new(max_delay: 8)
+      delay.write(impulse[0...8])
+      a = delay.read(1, tap: :a)
+      b = delay.read(3.5, tap: :b)
+      expect(a).to eq(MB::M.rol(impulse[0...8], -1))
+      expect(MB::M.round(b[3..4], 5)).to eq(Numo::SFloat[0.5, 0.5])
+    end
+  end
+
+  describe '#delay=' do
+    it 'raises an error if the delay is out of range' do
+      delay = MB::Sound::Filter::Delay.new(delay: 5, interpolation: :lagrange)
+      expect { delay.delay = 6 }.to raise_error(/between/)
+      expect { delay.delay = 0.5 }.to raise_error(/between/)
+      expect { delay.delay = Numo::SFloat[1, 6] }.to raise_error(/between/)
+    end
+  end
+
+  describe '#reset' do
+    it 'fills the delay line with a value' do
+      delay = MB::Sound::Filter::Delay.new(delay: 4)
+      expect(delay.reset(0.5)).to eq(0.5)
+      expect(delay.process(Numo::SFloat.zeros(6))).to eq(Numo::SFloat[0.5, 0.5, 0.5, 0.5, 0, 0])
+    end
+  end
+
+  describe '#latency' do
+    it 'is zero because the delay is part of the response' do
+      expect(MB::Sound::Filter::Delay.new(delay: 3.5).latency).to eq(0)
+      expect(MB::Sound::Filter::Delay.new(delay: Numo::SFloat[1, 2, 3, 6]).latency).to eq(0)
+    end
+  end
+
+  describe '#response' do
+    it 'returns the response of an ideal delay' do
+      delay = MB::Sound::Filter::Delay.new(delay: 2)
+      expect(MB::M.round(delay.response(Math::PI / 2), 6)).to eq(-1)
+      expect(MB::M.round(delay.frequency_response(3), 6)).to eq(Numo::DComplex[1, -1, 1])
+    end
+  end
+end
@@ -55,6 +55,14 @@ RSpec.describe(MB::Sound::Filter::FilterChain) do
     end
   end
 
+  describe '#latency' do
+    it 'adds the latencies of all filters' do
+      fir = MB::Sound::Filter::FIR.new({ 100 => 1, 200 => 1 })
+      expect(chain.latency).to eq(chain.filters.last.processing_delay)
+      expect(chain.chain(fir).latency).to eq(chain.filters[2].processing_delay + fir.processing_delay)
+    end
+  end
+
   describe '#initialize' do
     it 'can initialize a filter chain' do
       expect(chain.filters.length).to eq(3)
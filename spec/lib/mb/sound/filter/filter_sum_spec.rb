@@ -1,3 +1,63 @@
 RSpec.describe(MB::Sound::Filter::FilterSum) do
-  pending
+  let(:fir) { MB::Sound::Filter::FIR.new({ 100 => 1, 200 => 1 }, filter_length: 1000) }
+  let(:fir2) { MB::Sound::Filter::FIR.new({ 100 => 1, 200 => 1 }, filter_length: 1000) }
+  let(:impulse) { Numo::SFloat.zeros(fir.window_length * 4).tap { |d| d[0] = 1 } }
+
+  describe '#process' do
+    it 'adds the outputs of all filters' do
+      sum = MB::Sound::Filter::FilterSum.new(MB::Sound::Filter::Gain.new(0.5), MB::Sound::Filter::Gain.new(0.25))
+      expect(sum.process(Numo::SFloat[1, 2])).to eq(Numo::SFloat[0.75, 1.5])
+    end
+
+    it 'aligns filters with different latencies' do
+      sum = MB::Sound::Filter::FilterSum.new(fir, MB::Sound::Filter::Gain.new(1))
+      result = sum.process(impulse)
+
+      expected = fir2.process(impulse)
+      expected[fir2.latency] += 1
+
+      expect(MB::M.round(result, 5)).to eq(MB::M.round(expected, 5))
+    end
+
+    it 'does not align filters if compensation is disabled' do
+      sum = MB::Sound::Filter::FilterSum.new(fir, MB::Sound::Filter::Gain.new(1), compensate: false)
+      result = sum.process(impulse)
+      expect(result[0]).to eq(1)
+      expect(sum.branches).to eq(sum.filters)
+    end
+  end
+
+  describe '#latency' do
+    it 'is the highest latency of all filters' do
+      sum = MB::Sound::Filter::FilterSum.new(fir, MB::Sound::Filter::Gain.new(1))
+      expect(sum.latency).to eq(fir.processing_delay)
+      expect(sum.branches[1].filters.last.delay).to eq(fir.processing_delay)
+    end
+
+    it 'follows changes to filter latencies' do
+      variable = Class.new(MB::Sound::Filter::Gain) { attr_accessor :latency }.new(1)
+      variable.latency = 3
+
+      sum = MB::Sound::Filter::FilterSum.new(variable, MB::Sound::Filter::Gain.new(1))
+      expect(sum.latency).to eq(3)
+
+      variable.latency = 5
+      expect(sum.latency).to eq(5)
+      expect(sum.branches[1].filters.last.delay).to eq(5)
+      expect(sum.process(Numo::SFloat[1, 0, 0, 0, 0, 0])).to eq(Numo::SFloat[1, 0, 0, 0, 0, 1])
+    end
+  end
+
+  describe '#response' do
+    it 'matches the spectrum of the processed impulse' do
+      sum = MB::Sound::Filter::FilterSum.new(fir, MB::Sound::Filter::Gain.new(0.5))
+      n = fir.window_length
+      result = sum.process(impulse)[sum.latency...(sum.latency + n)]
+
+      expected = Numo::Pocketfft.rfft(Numo::DFloat.cast(result))
+      response = sum.response(Numo::DFloat.linspace(0, Math::PI, n / 2 + 1))
+
+      expect((response - expected).abs.max).to be < 1e-3
+    end
+  end
 end
@@ -90,6 +90,28 @@ RSpec.describe MB::Sound::Filter::FIR do
     end
   end
 
+  describe '.from_impulse' do
+    let(:impulse) { Numo::SFloat[0.25, 1, -0.5, 0.125, 0, 0.0625] }
+    let(:filter) { MB::Sound::Filter::FIR.from_impulse(impulse) }
+
+    it 'uses the impulse response as given' do
+      expect(filter.impulse).to eq(impulse)
+      expect(filter.filter_length).to eq(6)
+      expect(filter.impulse_delay).to eq(1)
+    end
+
+    it 'has gains matching the frequency response of the impulse' do
+      expect(filter.gains[0].real.round(5)).to eq(impulse.sum.round(5))
+      expect(filter.filter_fft[0].real.round(5)).to eq(impulse.sum.round(5))
+    end
+
+    it 'convolves with the impulse response' do
+      input = MB::M.zpad(Numo::SFloat[1], filter.window_length * 2)
+      result = filter.process(input)[filter.processing_delay...(filter.processing_delay + 6)]
+      expect(MB::M.round(result, 5)).to eq(impulse)
+    end
+  end
+
   context 'delay accessors' do
     [:unity_filter, :freq_filter, :complex_filter, :real_filter].each do |f|
       let(:filter) { send(f) }
@@ -112,6 +134,12 @@ RSpec.describe MB::Sound::Filter::FIR do
           expect(filter.processing_delay).to eq(process_delay)
         end
       end
+
+      describe '#latency' do
+        it "is the processing delay for #{f}" do
+          expect(filter.latency).to eq(process_delay)
+        end
+      end
     end
   end
 
@@ -61,6 +61,11 @@ RSpec.describe(MB::Sound::Filter::LinearFollower) do
 
       expect(MB::M.round(lf.process(data), 6)).to eq(expected)
     end
+
+    it 'flushes tiny values to zero' do
+      lf = MB::Sound::Filter::LinearFollower.new(rate: 1, max_rise: nil, max_fall: nil)
+      expect(lf.process(Numo::DFloat[1, 1e-20, -1e-300, 0.5])).to eq(Numo::DFloat[1, 0, 0, 0.5])
+    end
   end
 
   describe '#reset' do
@@ -3,5 +3,13 @@ RSpec.describe(MB::Sound::Filter::SimpleEnvelopeFollower) do
     expect { MB::Sound::Filter::SimpleEnvelopeFollower.new(rate: 48000) }.not_to raise_error
   end
 
+  it 'decays to exactly zero' do
+    f = MB::Sound::Filter::SimpleEnvelopeFollower.new(rate: 48000, decay_db: -100, decay_s: 0.01)
+    f.process(Numo::DFloat[1])
+    result = f.process(Numo::DFloat.zeros(4800))
+    expect(result[0]).to be > 0
+    expect(result[-1]).to eq(0)
+  end
+
   pending 'more tests'
 end
@@ -0,0 +1,90 @@
+require 'fileutils'
+
+RSpec.describe(MB::Sound::GranularSynth) do
+  let(:ones) { Numo::SFloat.ones(10000) }
+  let(:ramp) { Numo::SFloat.new(10000).seq }
+
+  describe '#sample' do
+    it 'shapes each grain with the window' do
+      synth = MB::Sound::GranularSynth.new(ones, channels: 1)
+      synth.add_grains(start: 0, offset: 100, length: 100)
+      result = synth.sample(200)[0]
+
+      expect(result[0].round(4)).to eq(0)
+      expect(result[50].round(4)).to eq(1)
+      expect(result[25].round(2)).to eq(0.5)
+      expect(result[100..-1].abs.max).to eq(0)
+    end
+
+    it 'starts grains at their start time across blocks' do
+      synth = MB::Sound::GranularSynth.new(ones, channels: 1)
+      synth.add_grains(start: 150, offset: 0, length: 100)
+
+      first = synth.sample(100)[0].dup
+      second = synth.sample(200)[0]
+      expect(first.abs.max).to eq(0)
+      expect(second[0...50].abs.max).to eq(0)
+      expect(second[100].round(4)).to eq(1)
+      expect(second[150..-1].abs.max).to eq(0)
+    end
+
+    it 'reads the source at the grain rate' do
+      synth = MB::Sound::GranularSynth.new(ramp, channels: 1, window: MB::Sound::Window::Rectangular)
+      synth.add_grains(start: 0, offset: 1000.5, length: 4, rate: 2)
+      expect(MB::M.round(synth.sample(4)[0], 3)).to eq(Numo::SFloat[1000.5, 1002.5, 1004.5, 1006.5])
+    end
+
+    it 'pans grains between channels' do
+      synth = MB::Sound::GranularSynth.new(ones)
+      synth.add_grains(start: 0, offset: 0, length: 100, pan: Numo::DFloat[-1, 1], gain: Numo::DFloat[1, 0.5])
+      l, r = synth.sample(100)
+
+      expect(l[50].round(4)).to eq(1)
+      expect(r[50].round(4)).to eq(0.5)
+    end
+
+    it 'mixes many grains' do
+      synth = MB::Sound::GranularSynth.new(ones, channels: 1)
+      synth.add_grains(start: Numo::DFloat.zeros(1000), offset: Numo::DFloat.new(1000).rand(0, 9000), length: 100, gain: 0.001)
+      expect(synth.sample(100)[0][50].round(4)).to eq(1)
+    end
+
+    it 'removes finished grains' do
+      synth = MB::Sound::GranularSynth.new(ones)
+      synth.add_grains(start: Numo::DFloat[0, 500], offset: 0, length: 100)
+      expect(synth.active_grains).to eq(2)
+
+      synth.sample(200)
+      expect(synth.active_grains).to eq(1)
+      expect(synth.time).to eq(200)
+    end
+
+    it 'plays grains from a MappedSample' do
+      FileUtils.mkdir_p('tmp')
+      MB::Sound::MappedSample.convert(MB::Sound::ArrayInput.new([ramp, ramp]), 'tmp/granular_test.f32')
+      mapped = MB::Sound::MappedSample.new('tmp/granular_test.f32')
+
+      from_array = MB::Sound::GranularSynth.new(ramp, channels: 1)
+      from_mapped = MB::Sound::GranularSynth.new(mapped, channels: 1)
+      [from_array, from_mapped].each do |s|
+        s.add_grains(start: Numo::DFloat[0, 10], offset: Numo::DFloat[100, 5000.25], length: 300, rate: Numo::DFloat[1.5, 0.75])
+      end
+
+      expect(MB::M.round(from_mapped.sample(400)[0], 2)).to eq(MB::M.round(from_array.sample(400)[0], 2))
+      mapped.close
+    end
+  end
+
+  describe '#add_grains' do
+    it 'drops grains beyond the maximum' do
+      synth = MB::Sound::GranularSynth.new(ones, max_grains: 3)
+      expect(synth.add_grains(start: Numo::DFloat.zeros(5), offset: 0, length: 10)).to eq(3)
+      expect(synth.dropped).to eq(2)
+    end
+
+    it 'requires start, offset, and length' do
+      synth = MB::Sound::GranularSynth.new(ones)
+      expect { synth.add_grains(start: 0, length: 10) }.to raise_error(/offset/)
+    end
+  end
+end
@@ -0,0 +1,84 @@
+require 'tmpdir'
+
+RSpec.describe(MB::Sound::JackNative) do
+  jackd = ENV['PATH'].split(':').map { |d| File.join(d, 'jackd') }.find { |f| File.executable?(f) }
+
+  if !MB::Sound::JackNative.available? || jackd.nil?
+    it 'requires the ffi gem, libjack, and jackd' do
+      skip 'JACK is not available'
+    end
+  else
+    before(:all) do
+      @server = "mb-sound-spec-#{Process.pid}"
+      @old_server = ENV['JACK_DEFAULT_SERVER']
+      ENV['JACK_DEFAULT_SERVER'] = @server
+      @jackd = Process.spawn(jackd, '-n', @server, '-d', 'dummy', '-r', '48000', '-p', '256', [:out, :err] => File::NULL)
+
+      deadline = MB::U.clock_now + 10
+      begin
+        @jack = MB::Sound::JackNative.new(name: 'mb-sound-spec')
+      rescue RuntimeError
+        raise if MB::U.clock_now > deadline
+        sleep 0.1
+        retry
+      end
+    end
+
+    after(:all) do
+      @jack&.close
+      Process.kill(:TERM, @jackd)
+      Process.wait(@jackd)
+      ENV['JACK_DEFAULT_SERVER'] = @old_server
+    end
+
+    it 'reports the server format' do
+      expect(@jack.rate).to eq(48000)
+      expect(@jack.buffer_size).to eq(256)
+    end
+
+    it 'passes audio from an output to a connected input' do
+      output = @jack.output(channels: 2)
+      input = @jack.input(channels: 2, connect: output.ports.map { |p| MB::Sound::JackNative::Lib.jack_port_name(p) })
+
+      data = [Numo::SFloat.new(4096).seq(1), -Numo::SFloat.new(4096).seq(1)]
+      writer = Thread.new { (0...4096).step(256) { |s| output.write(data.map { |c| c[s...(s + 256)] }) } }
+
+      # Find the start of the written signal among any leading silence
+      received = [Numo::SFloat[], Numo::SFloat[]]
+      until received[0].length >= 8192 || (received[0].length > 0 && received[0][-1] == 4096)
+        received = received.zip(input.read(256)).map { |r, c| r.concatenate(c) }
+      end
+      writer.join
+
+      start = (received[0] > 0).where[0]
+      expect(received[0][start...(start + 4096)]).to eq(data[0])
+      expect(received[1][start...(start + 4096)]).to eq(data[1])
+
+      input.close
+      output.close
+    end
+
+    it 'unregisters ports when a stream is closed' do
+      input = @jack.input(channels: 1)
+      name = MB::Sound::JackNative::Lib.jack_port_name(input.ports[0])
+      expect(@jack.ports(pattern: Regexp.escape(name))).to eq([name])
+
+      input.close
+      expect(@jack.ports(pattern: Regexp.escape(name))).to eq([])
+      expect(@jack.inputs).not_to include(input)
+    end
+
+    it 'buffers at least two JACK periods' do
+      input = @jack.input(channels: 1, buffer_size: 16)
+      expect(input.ring.capacity).to eq(512)
+      input.close
+    end
+
+    it 'counts output underruns when nothing is written' do
+      output = @jack.output(channels: 1)
+      sleep 0.1
+      expect(output.underruns).to be > 0
+      output.close
+    end
+  end
+end
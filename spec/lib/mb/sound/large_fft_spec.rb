@@ -0,0 +1,73 @@
+RSpec.describe(MB::Sound::LargeFFT) do
+  let(:data) { Numo::DComplex.new(1000).rand_norm }
+
+  after(:each) do
+    fft&.close
+  end
+
+  describe '.factor' do
+    let(:fft) { nil }
+
+    it 'returns the largest factor below the square root and its cofactor' do
+      expect(MB::Sound::LargeFFT.factor(1000)).to eq([25, 40])
+      expect(MB::Sound::LargeFFT.factor(1024)).to eq([32, 32])
+      expect(MB::Sound::LargeFFT.factor(7)).to eq([1, 7])
+    end
+  end
+
+  describe '.good_length' do
+    let(:fft) { nil }
+
+    it 'returns the same length if it fits in memory' do
+      expect(MB::Sound::LargeFFT.good_length(1000, 4096)).to eq(1000)
+    end
+
+    it 'pads prime lengths that would not fit in memory' do
+      length = MB::Sound::LargeFFT.good_length(1009, 4096)
+      expect(length).to be > 1009
+      expect(MB::Sound::LargeFFT.factor(length)[1] * 64).to be <= 4096
+    end
+  end
+
+  [1, 3].each do |workers|
+    context "with #{workers} workers" do
+      # A small memory limit forces multiple blocks per pass
+      let(:fft) { MB::Sound::LargeFFT.new(data.length, memory: 4096, workers: workers) }
+
+      it 'matches an in-memory FFT' do
+        fft.write(0, data)
+        fft.forward!
+        expect((fft.read(0, data.length) - Numo::Pocketfft.fft(data)).abs.max).to be < 1e-9
+      end
+
+      it 'can invert the forward transform' do
+        fft.write(0, data)
+        fft.forward!
+        fft.inverse!
+        expect((fft.read(0, data.length) - data).abs.max).to be < 1e-12
+      end
+    end
+  end
+
+  describe '#make_hermitian!' do
+    let(:fft) { MB::Sound::LargeFFT.new(data.length, memory: 4096, workers: 1) }
+
+    it 'makes the inverse transform real' do
+      fft.write(0, data)
+      fft.make_hermitian!
+      fft.inverse!
+
+      result = fft.read(0, data.length)
+      expect(result.imag.abs.max).to be < 1e-12
+      expect((result.real - Numo::Pocketfft.irfft(data[0..500])).abs.max).to be < 1e-12
+    end
+  end
+
+  describe '#initialize' do
+    let(:fft) { nil }
+
+    it 'raises an error if the length cannot be factored to fit in memory' do
+      expect { MB::Sound::LargeFFT.new(1009, memory: 4096) }.to raise_error(/pad to/)
+    end
+  end
+end
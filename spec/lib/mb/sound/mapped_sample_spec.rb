@@ -0,0 +1,73 @@
+require 'fileutils'
+
+RSpec.describe(MB::Sound::MappedSample) do
+  let(:left) { Numo::SFloat.new(100000).seq }
+  let(:right) { -Numo::SFloat.new(100000).seq }
+  let(:path) { 'tmp/mapped_sample_test.f32' }
+
+  before(:each) do
+    FileUtils.mkdir_p('tmp')
+    File.unlink(path) rescue nil
+  end
+
+  describe '.convert' do
+    it 'writes a raw sample file that can be opened' do
+      MB::Sound::MappedSample.convert(MB::Sound::ArrayInput.new([left, right], rate: 44100), path)
+      sample = MB::Sound::MappedSample.new(path)
+
+      expect(sample.channels).to eq(2)
+      expect(sample.rate).to eq(44100)
+      expect(sample.frames).to eq(100000)
+      expect(sample.mapped?).to eq(true)
+
+      sample.close
+    end
+  end
+
+  describe '#read' do
+    let(:sample) {
+      MB::Sound::MappedSample.convert(MB::Sound::ArrayInput.new([left, right]), path)
+      MB::Sound::MappedSample.new(path)
+    }
+
+    after(:each) do
+      sample.close
+    end
+
+    it 'reads a range of frames' do
+      expect(sample.read(70000, 5)).to eq([left[70000...70005], right[70000...70005]])
+    end
+
+    it 'reads interleaved frames' do
+      expect(sample.read_frames(10, 2)).to eq(Numo::SFloat[[10, -10], [11, -11]])
+    end
+
+    it 'fills frames outside the sample with zeros' do
+      expect(sample.read(-2, 4)[0]).to eq(Numo::SFloat[0, 0, 0, 1])
+      expect(sample.read(99998, 4)[0]).to eq(Numo::SFloat[99998, 99999, 0, 0])
+    end
+  end
+
+  describe '.cached' do
+    it 'converts an audio file once' do
+      FileUtils.rm_rf('tmp/mapped_sample_cache')
+
+      a = MB::Sound::MappedSample.cached('sounds/sine/sine_100_1s_mono.flac', cache_dir: 'tmp/mapped_sample_cache')
+      mtime = File.mtime(a.path)
+      b = MB::Sound::MappedSample.cached('sounds/sine/sine_100_1s_mono.flac', cache_dir: 'tmp/mapped_sample_cache')
+
+      expect(b.path).to eq(a.path)
+      expect(File.mtime(b.path)).to eq(mtime)
+      expect(a.frames).to be_within(100).of(48000)
+      expect(a.read(0, 48000)[0].abs.max).to be_within(0.05).of(1)
+
+      a.close
+      b.close
+    end
+  end
+
+  it 'raises an error for files that are not raw samples' do
+    File.write(path, 'x' * 100)
+    expect { MB::Sound::MappedSample.new(path) }.to raise_error(/not a raw sample/)
+  end
+end
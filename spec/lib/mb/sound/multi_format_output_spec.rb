@@ -0,0 +1,65 @@
+require 'fileutils'
+
+RSpec.describe(MB::Sound::MultiFormatOutput) do
+  let(:test_data) {
+    [
+      Numo::SFloat[0, 0.5, -0.5, 0],
+      Numo::SFloat[0, -0.75, 0.25, 0],
+    ]
+  }
+
+  let(:names) { ['tmp/multi_out.flac', 'tmp/multi_out.wav', 'tmp/multi_out.ogg'] }
+
+  before(:each) do
+    FileUtils.mkdir_p('./tmp')
+    names.each { |n| File.unlink(n) rescue nil }
+  end
+
+  it 'writes every target from one stream' do
+    output = MB::Sound::MultiFormatOutput.new(
+      [names[0], [names[1], 'pcm_s16le'], { filename: names[2], bitrate: '64k' }],
+      rate: 44100,
+      channels: 2
+    )
+    expect(output.filenames.map { |f| File.basename(f) }).to eq(names.map { |n| File.basename(n) })
+    expect(output.targets[1][:codec]).to eq('pcm_s16le')
+
+    output.write(test_data)
+    expect(output.close.success?).to eq(true)
+
+    names[0..1].each do |name|
+      input = MB::Sound::FFMPEGInput.new(name)
+      expect(input.rate).to eq(44100)
+      expect(input.channels).to eq(2)
+      data = input.read(input.frames).map { |c| c.map { |v| v.round(3) } }
+      expect(input.close.success?).to eq(true)
+      expect(data).to eq(test_data)
+    end
+
+    expect(File.size(names[2])).to be > 0
+    expect(MB::Sound::FFMPEGInput.parse_info(names[1])[:streams][0][:codec_name]).to eq('pcm_s16le')
+  end
+
+  it 'raises an error if no targets are given' do
+    expect { MB::Sound::MultiFormatOutput.new([], rate: 48000, channels: 1) }.to raise_error(/target/)
+  end
+
+  it 'raises an error if a target directory does not exist' do
+    expect {
+      MB::Sound::MultiFormatOutput.new(['/nonexistent/dir/x.flac'], rate: 48000, channels: 1)
+    }.to raise_error(/directory/)
+  end
+
+  it 'passes filenames with a format override through without checking the directory' do
+    output = MB::Sound::MultiFormatOutput.new(
+      [names[0], { filename: '/nonexistent/dir/null', format: 'null' }],
+      rate: 48000,
+      channels: 2
+    )
+    expect(output.filenames[1]).to eq('/nonexistent/dir/null')
+
+    output.write(test_data)
+    expect(output.close.success?).to eq(true)
+    expect(File.size(names[0])).to be > 0
+  end
+end
@@ -118,4 +118,95 @@ RSpec.describe(MB::Sound::MultiWriter) do
       expect(null_out_5.frames_written).to eq(800)
     end
   end
+
+  context 'in concurrent mode' do
+    # An output that takes a while to write, recording what it received
+    let(:slow_class) {
+      Class.new(MB::Sound::NullOutput) do
+        attr_reader :received
+
+        def initialize(delay:, **kwargs)
+          super(**kwargs, sleep: false)
+          @delay = delay
+          @received = []
+        end
+
+        def write(data)
+          Kernel.sleep(@delay)
+          @received << data.map(&:dup)
+          super
+        end
+      end
+    }
+
+    let(:slow_out) { slow_class.new(delay: 0.05, channels: 2) }
+
+    it 'delivers every buffer to every output' do
+      multi = MB::Sound::MultiWriter.new([null_out_1, slow_out], concurrent: true, policy: [:sync, :block])
+      10.times { multi.write(data2) }
+      multi.close
+
+      expect(null_out_1.frames_written).to eq(8000)
+      expect(slow_out.frames_written).to eq(8000)
+      expect(multi.stats.map { |s| s[:written] }).to eq([10, 10])
+    end
+
+    it 'does not delay synchronous outputs for slow queued outputs' do
+      multi = MB::Sound::MultiWriter.new([null_out_1, slow_out], concurrent: true, policy: [:sync, :grow])
+
+      start = MB::U.clock_now
+      10.times { multi.write(data2) }
+      elapsed = MB::U.clock_now - start
+
+      expect(elapsed).to be < 0.25
+      expect(null_out_1.frames_written).to eq(8000)
+      expect(multi.stats[1][:max_queued]).to be > 1
+      expect(multi.stats[1][:lag]).to be > 0
+
+      multi.close
+      expect(slow_out.frames_written).to eq(8000)
+    end
+
+    it 'drops buffers for a full queue with the :drop policy' do
+      multi = MB::Sound::MultiWriter.new([null_out_1, slow_out], concurrent: true, policy: [:sync, :drop], queue_size: 1)
+      10.times { multi.write(data2) }
+      multi.close
+
+      stats = multi.stats[1]
+      expect(stats[:dropped]).to be > 0
+      expect(stats[:dropped] + stats[:written]).to eq(10)
+      expect(null_out_1.frames_written).to eq(8000)
+    end
+
+    it 'copies data so the caller may reuse buffers' do
+      multi = MB::Sound::MultiWriter.new([slow_out], concurrent: true)
+      buf = [Numo::SFloat.zeros(800), Numo::SFloat.zeros(800)]
+      multi.write(buf)
+      buf[0].fill(1)
+      multi.close
+
+      expect(slow_out.received[0][0].max).to eq(0)
+    end
+
+    it 'raises errors from writer threads' do
+      bad = MB::Sound::NullOutput.new(channels: 1, sleep: false)
+      allow(bad).to receive(:write).and_raise(IOError, 'broken')
+
+      multi = MB::Sound::MultiWriter.new([bad], concurrent: true)
+      multi.write(data1)
+      expect { multi.close }.to raise_error(IOError, 'broken')
+    end
+
+    it 'raises an error for an invalid policy' do
+      expect {
+        MB::Sound::MultiWriter.new([null_out_1], concurrent: true, policy: :sometimes)
+      }.to raise_error(ArgumentError, /policies/)
+    end
+
+    it 'raises an error when writing after closing' do
+      multi = MB::Sound::MultiWriter.new([null_out_1], concurrent: true)
+      multi.close
+      expect { multi.write(data1) }.to raise_error(IOError)
+    end
+  end
 end
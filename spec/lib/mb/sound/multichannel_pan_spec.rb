@@ -0,0 +1,60 @@
+RSpec.describe(MB::Sound::MultichannelPan) do
+  let(:quad) { MB::Sound::MultichannelPan.new(speakers: [45, -45, 135, -135].map(&:degrees)) }
+
+  describe '#gains' do
+    it 'sends a source at a speaker only to that speaker' do
+      expect(MB::M.round(quad.gains([45.degrees, -135.degrees]), 6)).to eq(Numo::DFloat[[1, 0], [0, 0], [0, 0], [0, 1]])
+    end
+
+    it 'pans between adjacent speakers with constant power' do
+      g = quad.gains(Numo::DFloat.new(50).rand(-Math::PI, Math::PI))
+      expect(MB::M.round((g ** 2).sum(axis: 0), 6)).to eq(Numo::DFloat.ones(50))
+      expect((g > 0).count_true(axis: 0).max).to be <= 2
+    end
+
+    it 'pans across the wraparound between the last and first speakers' do
+      g = quad.gains(180.degrees)
+      expect(MB::M.round(g, 6)).to eq(MB::M.round(Numo::DFloat[0, 0, 0.5 ** 0.5, 0.5 ** 0.5], 6))
+    end
+
+    it 'works with a stereo pair' do
+      stereo = MB::Sound::MultichannelPan.new(speakers: [30.degrees, -30.degrees], center_gain: MB::Sound::ComplexPan::DB_6)
+      expect(MB::M.round(stereo.gains([0, 30.degrees, 180.degrees]), 6)).to eq(Numo::DFloat[[0.5, 1, 0.5], [0.5, 0, 0.5]])
+    end
+
+    it 'raises an error for duplicate speaker azimuths' do
+      expect { MB::Sound::MultichannelPan.new(speakers: [0, 2 * Math::PI]) }.to raise_error(/different/)
+    end
+  end
+
+  describe '#process' do
+    it 'mixes many sources to every speaker' do
+      sources = Numo::SFloat.new(200, 64).rand(-1, 1)
+      angles = Numo::DFloat.new(200).rand(-Math::PI, Math::PI)
+
+      out = quad.process(sources, angles)
+      expect(out.length).to eq(4)
+      expect(out[0]).to be_a(Numo::SFloat)
+
+      expected = Numo::SFloat.cast(quad.gains(angles).dot(sources))
+      4.times do |c|
+        expect(MB::M.round(out[c], 4)).to eq(MB::M.round(expected[c, true], 4))
+      end
+    end
+
+    it 'ramps between buffers when azimuths change' do
+      src = [Numo::SFloat.ones(4)]
+      quad.process(src, [45.degrees])
+      out = quad.process(src, [-45.degrees])
+
+      expect(MB::M.round(out[0], 6).to_a).to eq([0.75, 0.5, 0.25, 0])
+      expect(MB::M.round(out[1], 6).to_a).to eq([0.25, 0.5, 0.75, 1])
+    end
+
+    it 'can automate azimuth per sample' do
+      out = quad.process(Numo::SFloat.ones(1, 2), Numo::DFloat[[45.degrees, -45.degrees]])
+      expect(MB::M.round(out[0], 6).to_a).to eq([1, 0])
+      expect(MB::M.round(out[1], 6).to_a).to eq([0, 1])
+    end
+  end
+end
@@ -0,0 +1,113 @@
+RSpec.describe(MB::Sound::NoiseReduction) do
+  let(:bins) { 513 }
+
+  # Returns a [channels, bins] frame of complex Gaussian noise plus an
+  # optional tone in bin 100.
+  def frame(tone: 0, channels: 2)
+    noise = Numo::DComplex.new(channels, bins).rand_norm(0, 1)
+    noise[true, 100] += tone
+    noise
+  end
+
+  describe '#process' do
+    [:wiener, :subtraction].each do |mode|
+      it "attenuates noise and keeps a strong tone using #{mode}" do
+        nr = MB::Sound::NoiseReduction.new(mode: mode, learn_frames: 50, freq_smoothing: 0)
+        50.times { nr.process(frame) }
+
+        input = nil
+        result = nil
+        10.times {
+          input = frame(tone: 100)
+          result = nr.process(input.dup)
+        }
+
+        expect(result[true, 100].abs.min).to be > 90
+        expect(MB::M.db(result[true, 300..400].abs.mean / input[true, 300..400].abs.mean)).to be < -6
+      end
+    end
+
+    it 'attenuates the learning frames by the floor gain' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 2, floor: 0.25)
+      f = frame
+      expect(nr.process(f.dup)).to eq(f * 0.25)
+      expect(nr.learned_frames).to eq(1)
+    end
+
+    it 'processes an Array of channels' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 10)
+      10.times { nr.process(frame.to_a.map { |c| Numo::DComplex.cast(c) }) }
+
+      result = nr.process(frame(tone: 100).to_a.map { |c| Numo::DComplex.cast(c) })
+      expect(result.length).to eq(2)
+      expect(result[0][100].abs).to be > 90
+    end
+
+    it 'returns frames unmodified without a noise profile' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 0)
+      f = frame
+      expect(nr.process(f.dup)).to eq(f)
+    end
+
+    it 'never reduces gain below the floor' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 10, floor: 0.5, strength: 10)
+      10.times { nr.process(frame) }
+      f = frame
+      result = nr.process(f.dup)
+      expect((result.abs / f.abs).min).to be >= 0.4999
+    end
+
+    it 'smooths gains over time' do
+      fast = MB::Sound::NoiseReduction.new(learn_frames: 10, time_smoothing: 0)
+      slow = MB::Sound::NoiseReduction.new(learn_frames: 10, time_smoothing: 0.9)
+      noise = 10.times.map { frame }
+      noise.each { |f| fast.process(f.dup); slow.process(f.dup) }
+
+      # The tone starts suddenly, so the smoothed gain is still low
+      tone = frame(tone: 100)
+      expect(slow.process(tone.dup)[0, 100].abs).to be < fast.process(tone.dup)[0, 100].abs * 0.5
+    end
+
+    it 'raises an error if the frame size changes' do
+      nr = MB::Sound::NoiseReduction.new
+      nr.process(frame)
+      expect { nr.process(frame(channels: 1)) }.to raise_error(/Frame size/)
+    end
+  end
+
+  describe '#learn_from' do
+    it 'learns the noise profile from audio' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 0)
+      nr.learn_from([Numo::SFloat.new(48000).rand_norm(0, 0.1)], MB::Sound::Window::Hann.new(1024))
+
+      expect(nr.learned_frames).to be > 10
+      expect(nr.noise_profile.shape).to eq([1, 513])
+      expect(nr.noise_profile.mean).to be > 0
+    end
+  end
+
+  describe '#noise_profile=' do
+    it 'can copy a profile between instances' do
+      a = MB::Sound::NoiseReduction.new(learn_frames: 5)
+      5.times { a.process(frame) }
+
+      b = MB::Sound::NoiseReduction.new(learn_frames: 0)
+      b.noise_profile = a.noise_profile
+      expect(b.noise_profile).to eq(a.noise_profile)
+    end
+  end
+
+  describe '#reset' do
+    it 'forgets the noise profile' do
+      nr = MB::Sound::NoiseReduction.new(learn_frames: 5)
+      5.times { nr.process(frame) }
+      nr.reset
+      expect(nr.noise_profile).to eq(nil)
+    end
+  end
+
+  it 'can be used as a block for process_window' do
+    nr = MB::Sound::NoiseReduction.new(learn_frames: 0)
+    expect(nr.to_proc.call([Numo::DComplex[1, 2]])).to eq([Numo::DComplex[1, 2]])
+  end
+end
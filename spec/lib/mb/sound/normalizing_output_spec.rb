@@ -0,0 +1,49 @@
+RSpec.describe(MB::Sound::NormalizingOutput) do
+  let(:collector) { MB::Sound::SpecSupport::CollectingOutput.new(channels: 2) }
+
+  let(:output) { MB::Sound::NormalizingOutput.new(collector) }
+
+  it 'writes nothing until closed' do
+    output.write([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+    expect(collector.data[0].length).to eq(0)
+    expect(output.frames_written).to eq(2)
+  end
+
+  it 'scales loud audio down to the limit' do
+    output.write([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+    output.write([Numo::SFloat[-8, 0], Numo::SFloat[0, 1]])
+    expect(output.peak).to eq(8)
+    output.close
+
+    expect(collector.closed).to eq(true)
+    expect(collector.data[0].to_a).to eq([0.125, 0.25, -1, 0])
+    expect(collector.data[1].to_a).to eq([0.375, 0.5, 0, 0.125])
+  end
+
+  it 'leaves quiet audio unchanged' do
+    output.write([Numo::SFloat[0.5, -0.25], Numo::SFloat[0.125, 0]])
+    output.close
+    expect(collector.data[0].to_a).to eq([0.5, -0.25])
+    expect(collector.data[1].to_a).to eq([0.125, 0])
+  end
+
+  it 'can make quiet audio louder' do
+    output = MB::Sound::NormalizingOutput.new(collector, louder: true)
+    output.write([Numo::SFloat[0.5, -0.25], Numo::SFloat[0.125, 0]])
+    output.close
+    expect(collector.data[0].to_a).to eq([1, -0.5])
+  end
+
+  it 'copies audio longer than one copy block' do
+    data = Numo::SFloat.new(MB::Sound::NormalizingOutput::COPY_SIZE + 100).seq
+    output.write([data, -data])
+    output.close
+    expect(collector.data[0].length).to eq(data.length)
+    expect(collector.data[0][-1]).to eq(1)
+    expect(collector.data[1][-1]).to eq(-1)
+  end
+
+  it 'raises an error for the wrong number of channels' do
+    expect { output.write([Numo::SFloat[1]]) }.to raise_error(ArgumentError)
+  end
+end
@@ -16,8 +16,43 @@ RSpec.describe(MB::Sound::PlaybackMethods) do
       MB::Sound.play('sounds/synth0.flac', plot: false)
     end
 
-    pending 'can play a Tone'
-    pending 'can play a Numo::NArray'
+    context 'with in-memory data' do
+      let(:chunks) { [] }
+
+      before(:each) do
+        allow(MB::Sound).to receive(:puts)
+        allow_any_instance_of(MB::Sound::NullOutput).to receive(:write) { |_, d| chunks << d.map(&:dup) }
+      end
+
+      it 'can play a Tone' do
+        MB::Sound.play(100.hz.for(0.05), plot: false)
+        expect(chunks.map { |c| c[0].length }.uniq.length).to eq(1)
+        expect(chunks.sum { |c| c[0].length }).to be >= 2400
+      end
+
+      it 'can play a Numo::NArray in padded buffer-sized chunks' do
+        data = Numo::SFloat.new(2000).seq
+        MB::Sound.play(data, plot: false)
+
+        size = chunks[0][0].length
+        expect(chunks.map { |c| c[0].length }.uniq).to eq([size])
+        expect(chunks[0].length).to eq(2)
+
+        result = Numo::SFloat.cast(chunks.map { |c| c[0].to_a }.flatten)
+        expect(result[0...2000]).to eq(data)
+        expect(result[2000..-1].abs.max).to eq(0) if result.length > 2000
+      end
+
+      it 'applies gain without modifying the original data' do
+        data = Numo::SFloat.new(2000).seq
+        MB::Sound.play(data, gain: 0.5, plot: false)
+
+        result = Numo::SFloat.cast(chunks.map { |c| c[1].to_a }.flatten)
+        expect(result[0...2000]).to eq(data * 0.5)
+        expect(data[-1]).to eq(1999)
+      end
+    end
+
     pending 'can play an array of sounds for separate channels'
   end
 end
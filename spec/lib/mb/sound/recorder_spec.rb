@@ -0,0 +1,56 @@
+RSpec.describe(MB::Sound::Recorder) do
+  let(:outputs) { [] }
+  let(:factory) {
+    ->(filename, channels:, rate:) {
+      MB::Sound::SpecSupport::CollectingOutput.new(filename: filename, channels: channels, rate: rate).tap { |o| outputs << o }
+    }
+  }
+
+  let(:data) { [Numo::SFloat.new(10000).seq, -Numo::SFloat.new(10000).seq] }
+  let(:input) { MB::Sound::ArrayInput.new(data, rate: 1000, buffer_size: 300) }
+
+  it 'splits the input into sample-continuous segments by duration' do
+    recorder = MB::Sound::Recorder.new(input, '/tmp/segment-%{index}.flac', segment_seconds: 2.5, output: factory)
+    recorder.start
+    segments = recorder.wait
+
+    expect(segments).to eq(4.times.map { |i| "/tmp/segment-000#{i}.flac" })
+    expect(outputs.map { |o| o.data[0].length }).to eq([2500] * 4)
+    expect(outputs.map { |o| o.data[0] }.inject(:concatenate)).to eq(data[0])
+    expect(outputs.map { |o| o.data[1] }.inject(:concatenate)).to eq(data[1])
+    expect(outputs.all?(&:closed)).to eq(true)
+    expect(recorder.frames_written).to eq(10000)
+    expect(recorder.dropped_frames).to eq(0)
+    expect(recorder.errors).to be_empty
+  end
+
+  it 'does not reuse a filename for segments started in the same second' do
+    recorder = MB::Sound::Recorder.new(input, '/tmp/same.flac', segment_seconds: 2.5, output: factory)
+    recorder.start
+
+    expect(recorder.wait).to eq(['/tmp/same.flac', '/tmp/same-0001.flac', '/tmp/same-0002.flac', '/tmp/same-0003.flac'])
+    expect(outputs.map(&:filename)).to eq(recorder.segments)
+  end
+
+  it 'writes a single segment if there is no limit' do
+    recorder = MB::Sound::Recorder.new(input, '/tmp/all.flac', segment_seconds: nil, output: factory)
+    recorder.start
+    expect(recorder.wait).to eq(['/tmp/all.flac'])
+    expect(outputs[0].data[0]).to eq(data[0])
+  end
+
+  it 'counts dropped frames instead of waiting for a slow output' do
+    slow = ->(filename, channels:, rate:) {
+      MB::Sound::SpecSupport::CollectingOutput.new(filename: filename, channels: channels, rate: rate, delay: 0.05).tap { |o| outputs << o }
+    }
+
+    recorder = MB::Sound::Recorder.new(input, '/tmp/slow.flac', segment_seconds: nil, ring_seconds: 0.3, output: slow)
+    recorder.start
+    recorder.wait
+
+    expect(recorder.frames_captured).to eq(10000)
+    expect(recorder.dropped_frames).to be > 0
+    expect(recorder.frames_written + recorder.dropped_frames).to eq(10000)
+    expect(outputs[0].data[0].length).to eq(recorder.frames_written)
+  end
+end
@@ -0,0 +1,63 @@
+RSpec.describe(MB::Sound::RingBuffer) do
+  let(:ring) { MB::Sound::RingBuffer.new(channels: 2, capacity: 5) }
+
+  it 'starts empty' do
+    expect(ring.empty?).to eq(true)
+    expect(ring.full?).to eq(false)
+    expect(ring.available).to eq(0)
+    expect(ring.space).to eq(5)
+  end
+
+  describe '#write' do
+    it 'returns the number of frames that fit' do
+      expect(ring.write([Numo::SFloat[1, 2, 3], Numo::SFloat[4, 5, 6]])).to eq(3)
+      expect(ring.write([Numo::SFloat[1, 2, 3], Numo::SFloat[4, 5, 6]])).to eq(2)
+      expect(ring.full?).to eq(true)
+      expect(ring.write([Numo::SFloat[1], Numo::SFloat[2]])).to eq(0)
+    end
+
+    it 'raises an error if given the wrong number of channels' do
+      expect { ring.write([Numo::SFloat[1]]) }.to raise_error(/channels/)
+    end
+  end
+
+  describe '#read' do
+    it 'returns data in the order it was written across the wraparound' do
+      ring.write([Numo::SFloat[1, 2, 3, 4], Numo::SFloat[5, 6, 7, 8]])
+      expect(ring.read(3)).to eq([Numo::SFloat[1, 2, 3], Numo::SFloat[5, 6, 7]])
+
+      ring.write([Numo::SFloat[9, 10, 11], Numo::SFloat[12, 13, 14]])
+      expect(ring.read(10)).to eq([Numo::SFloat[4, 9, 10, 11], Numo::SFloat[8, 12, 13, 14]])
+      expect(ring.empty?).to eq(true)
+    end
+
+    it 'returns empty arrays when there is nothing to read' do
+      expect(ring.read(3).map(&:length)).to eq([0, 0])
+    end
+
+    it 'can copy into existing arrays' do
+      out = [Numo::SFloat.zeros(4), Numo::SFloat.zeros(4)]
+      ring.write([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+      result = ring.read(4, out: out)
+      expect(result).to eq([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+      expect(out[0]).to eq(Numo::SFloat[1, 2, 0, 0])
+    end
+  end
+
+  describe '#peek' do
+    it 'leaves data in the buffer' do
+      ring.write([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+      expect(ring.peek(1)).to eq([Numo::SFloat[1], Numo::SFloat[3]])
+      expect(ring.available).to eq(2)
+    end
+  end
+
+  describe '#skip' do
+    it 'discards frames' do
+      ring.write([Numo::SFloat[1, 2, 3], Numo::SFloat[4, 5, 6]])
+      expect(ring.skip(2)).to eq(2)
+      expect(ring.read(5)).to eq([Numo::SFloat[3], Numo::SFloat[6]])
+      expect(ring.skip(1)).to eq(0)
+    end
+  end
+end
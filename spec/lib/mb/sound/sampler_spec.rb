@@ -0,0 +1,103 @@
+require 'fileutils'
+
+RSpec.describe(MB::Sound::Sampler) do
+  let(:data) { Numo::SFloat.new(1000).seq }
+  let(:sample) {
+    FileUtils.mkdir_p('tmp')
+    MB::Sound::MappedSample.convert(MB::Sound::ArrayInput.new([data]), 'tmp/sampler_test.f32')
+    MB::Sound::MappedSample.new('tmp/sampler_test.f32')
+  }
+  let(:sampler) {
+    MB::Sound::Sampler.new(voices: 2, channels: 2).tap { |s|
+      s.add_sample(sample, root: 60, notes: 0..127)
+    }
+  }
+
+  after(:each) do
+    sample.close
+  end
+
+  describe '#trigger' do
+    it 'plays the root note at the original rate on all channels' do
+      sampler.trigger(60, 127)
+      l, r = sampler.sample(10)
+      expect(l).to eq(data[0...10])
+      expect(r).to eq(data[0...10])
+    end
+
+    it 'transposes by changing the playback rate' do
+      sampler.trigger(72, 127)
+      expect(sampler.sample(5)[0]).to eq(Numo::SFloat[0, 2, 4, 6, 8])
+    end
+
+    it 'interpolates between frames' do
+      sampler.trigger(53, 127)
+      result = sampler.sample(4)[0]
+      step = 2.0 ** (-7 / 12.0)
+      expect(MB::M.round(result, 4)).to eq(MB::M.round(Numo::SFloat[0, step, 2 * step, 3 * step], 4))
+    end
+
+    it 'stops at the end of the sample' do
+      sampler.trigger(60, 127)
+      result = sampler.sample(1200)[0]
+      expect(result[0...1000]).to eq(data)
+      expect(result[1000..-1].abs.max).to eq(0)
+      expect(sampler.active_voices).to eq(0)
+    end
+
+    it 'loops between loop points' do
+      s = MB::Sound::Sampler.new(channels: 1)
+      s.add_sample(sample, root: 60, loop_start: 10, loop_end: 14)
+      s.trigger(60, 127)
+      expect(s.sample(20)[0]).to eq(Numo::SFloat[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 10, 11, 12, 13, 10, 11])
+      expect(s.sample(4)[0]).to eq(Numo::SFloat[12, 13, 10, 11])
+    end
+
+    it 'interpolates from the loop end back to the loop start when looping the whole sample' do
+      s = MB::Sound::Sampler.new(channels: 1)
+      s.add_sample(sample, root: 60, loop_start: 0, loop_end: 1000)
+      s.trigger(48, 127)
+
+      result = s.sample(2000)[0]
+      expect(result[-3..-1]).to eq(Numo::SFloat[998.5, 999, 499.5])
+      expect(s.sample(3)[0]).to eq(Numo::SFloat[0, 0.5, 1])
+    end
+
+    it 'returns nil for unmapped notes' do
+      s = MB::Sound::Sampler.new
+      s.add_sample(sample, root: 60, notes: 48..72)
+      expect(s.trigger(20, 100)).to eq(nil)
+    end
+
+    it 'steals the oldest voice when all are busy' do
+      first = sampler.trigger(60, 127)
+      sampler.trigger(62, 127)
+      third = sampler.trigger(64, 127)
+
+      expect(third).to equal(first)
+      expect(third.note).to eq(64)
+      expect(sampler.active_voices).to eq(2)
+    end
+  end
+
+  describe '#release' do
+    it 'fades out and stops the voice' do
+      sampler.release_time = 10.0 / 48000
+      sampler.trigger(60, 127)
+      sampler.sample(100)
+      sampler.release(60, 0)
+
+      result = sampler.sample(20)[0]
+      expect(result[0]).to eq(100)
+      expect(result[5]).to be < 105 * 0.6
+      expect(result[10..-1].abs.max).to eq(0)
+      expect(sampler.active_voices).to eq(0)
+    end
+  end
+
+  it 'mixes multiple voices' do
+    sampler.trigger(60, 127)
+    sampler.trigger(72, 127)
+    expect(sampler.sample(3)[0]).to eq(Numo::SFloat[0, 3, 6])
+  end
+end
@@ -0,0 +1,93 @@
+RSpec.describe(MB::Sound::SharedRing) do
+  let(:path) { MB::Sound::SharedRing.temp_path('spec') }
+  let(:ring) { MB::Sound::SharedRing.new(path, channels: 2, capacity: 5) }
+
+  after(:each) do
+    ring.unlink
+  end
+
+  it 'can be opened by path with the same format' do
+    other = MB::Sound::SharedRing.open(path)
+    expect(other.channels).to eq(2)
+    expect(other.capacity).to eq(5)
+    expect(other.rate).to eq(48000)
+    other.close
+  end
+
+  it 'raises an error when opening a file that is not a ring' do
+    File.write(path + '.bad', 'x' * 100)
+    expect { MB::Sound::SharedRing.open(path + '.bad') }.to raise_error(/not a shared ring/)
+  ensure
+    File.unlink(path + '.bad')
+  end
+
+  it 'returns data in the order it was written across the wraparound' do
+    expect(ring.write([Numo::SFloat[1, 2, 3, 4], Numo::SFloat[5, 6, 7, 8]])).to eq(4)
+    expect(ring.read(3)).to eq([Numo::SFloat[1, 2, 3], Numo::SFloat[5, 6, 7]])
+
+    expect(ring.write([Numo::SFloat[9, 10, 11, 12, 13], Numo::SFloat[14, 15, 16, 17, 18]])).to eq(4)
+    expect(ring.space).to eq(0)
+    expect(ring.read(10)).to eq([Numo::SFloat[4, 9, 10, 11, 12], Numo::SFloat[8, 14, 15, 16, 17]])
+    expect(ring.available).to eq(0)
+  end
+
+  it 'shares data with another handle to the same file' do
+    other = MB::Sound::SharedRing.open(path)
+    ring.write([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+    expect(other.available).to eq(2)
+    expect(other.read(2)).to eq([Numo::SFloat[1, 2], Numo::SFloat[3, 4]])
+    expect(ring.space).to eq(5)
+
+    ring.finish
+    expect(other.finished?).to eq(true)
+    other.close
+  end
+
+  context 'with SharedRingOutput and SharedRingInput' do
+    it 'raises an error when writing to a full ring after the reader closes' do
+      output = MB::Sound::SharedRingOutput.new(path + '.closed', channels: 1, buffer_size: 4, capacity: 4)
+      input = MB::Sound::SharedRingInput.new(path + '.closed')
+
+      output.write([Numo::SFloat[1, 2, 3]])
+      input.close
+
+      expect { output.write([Numo::SFloat[4, 5, 6]]) }.to raise_error(IOError, /reader has closed/)
+      expect(output.ring.reader_closed?).to eq(true)
+    ensure
+      output&.ring&.close
+    end
+
+    it 'streams audio to a SharedRingInput in another process' do
+      stream_path = path + '.stream'
+      data = Numo::SFloat.new(10000).seq
+
+      pid = fork do
+        output = MB::Sound::SharedRingOutput.new(stream_path, channels: 2, buffer_size: 100)
+        (0...10000).step(300) do |start|
+          output.write([data[start...[start + 300, 10000].min], -data[start...[start + 300, 10000].min]])
+        end
+        output.close
+      ensure
+        exit!(0)
+      end
+
+      input = MB::Sound::SharedRingInput.new(stream_path, wait: 10)
+      expect(input.channels).to eq(2)
+
+      chunks = []
+      loop do
+        chunk = input.read(256)
+        break if chunk[0].empty?
+        chunks << chunk
+      end
+
+      Process.wait(pid)
+      input.close
+
+      expect(input.frames_read).to eq(10000)
+      expect(chunks.map { |c| c[0] }.inject(:concatenate)).to eq(data)
+      expect(chunks.map { |c| c[1] }.inject(:concatenate)).to eq(-data)
+      expect(File.exist?(stream_path)).to eq(false)
+    end
+  end
+end
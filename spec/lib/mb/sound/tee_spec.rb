@@ -0,0 +1,103 @@
+RSpec.describe(MB::Sound::Tee) do
+  let(:data) { [Numo::SFloat.new(100).seq, Numo::SFloat.new(100).seq(100)] }
+  let(:input) { MB::Sound::ArrayInput.new(data, buffer_size: 10) }
+  let(:tee) { MB::Sound::Tee.new(input) }
+
+  after(:each) { tee.close }
+
+  it 'passes through the input unchanged' do
+    expect(tee.channels).to eq(2)
+    expect(tee.read(10)).to eq(data.map { |c| c[0...10] })
+  end
+
+  it 'gives consumers the same arrays as the main path' do
+    seen = []
+    tee.add_consumer { |d, idx| seen << [d, idx] }
+
+    main = 3.times.map { tee.read(10) }
+
+    expect(seen.map(&:last)).to eq([0, 1, 2])
+    seen.each_with_index do |(d, _), idx|
+      expect(d).to equal(main[idx])
+    end
+  end
+
+  it 'calls consumers at their own cadence' do
+    every = []
+    tee.add_consumer(every: 4) { |_, idx| every << idx }
+
+    10.times { tee.read(10) }
+
+    expect(every).to eq([0, 4, 8])
+  end
+
+  it 'releases buffers when the main path and consumers are done with them' do
+    tee.add_consumer { }
+    tee.read(10)
+    expect(tee.live_buffers).to eq(1)
+    tee.read(10)
+    expect(tee.live_buffers).to eq(1)
+    tee.close
+    expect(tee.live_buffers).to eq(0)
+  end
+
+  context 'with threaded consumers' do
+    it 'runs consumers on another thread' do
+      threads = []
+      c = tee.add_consumer(thread: true, queue_size: 100) { threads << Thread.current }
+      5.times { tee.read(10) }
+      tee.close
+
+      expect(c.received).to eq(5)
+      expect(threads.uniq.length).to eq(1)
+      expect(threads[0]).not_to eq(Thread.current)
+      expect(tee.live_buffers).to eq(0)
+    end
+
+    it 'keeps buffers alive until a slow consumer releases them' do
+      gate = Queue.new
+      c = tee.add_consumer(thread: true, queue_size: 2) { gate.pop }
+
+      5.times { tee.read(10) }
+      expect(tee.live_buffers).to be_between(2, 4)
+      expect(c.dropped).to be >= 1
+
+      10.times { gate.push(true) }
+      tee.close
+
+      expect(c.received + c.dropped).to eq(5)
+      expect(tee.live_buffers).to eq(0)
+    end
+
+    it 'waits for consumers before giving the main path exclusive use of a buffer' do
+      gate = Queue.new
+      sums = Queue.new
+      tee.add_consumer(thread: true) { |d| gate.pop; sums.push(d[0].sum) }
+
+      buffer = tee.read_buffer(10)
+      expect(buffer.refs).to eq(2)
+
+      waiter = Thread.new { buffer.exclusive }
+      sleep 0.05
+      expect(waiter).to be_alive
+
+      gate.push(true)
+      expect(waiter.value).to equal(buffer.data)
+      expect(buffer.refs).to eq(1)
+      expect(sums.pop).to eq(45)
+
+      # Now safe to modify in place
+      buffer.data[0].fill(0)
+      buffer.release
+      expect(buffer.refs).to eq(0)
+      expect(tee.live_buffers).to eq(0)
+    end
+
+    it 'records consumer errors without affecting the main path' do
+      c = tee.add_consumer(thread: true) { raise 'analysis failed' }
+      3.times { expect(tee.read(10)[0].length).to eq(10) }
+      tee.close
+      expect(c.error.message).to eq('analysis failed')
+    end
+  end
+end
@@ -0,0 +1,37 @@
+RSpec.describe(MB::Sound::ToneCache) do
+  let(:cache) { MB::Sound::ToneCache.new(max_samples: 1000) }
+
+  it 'calls the block only on a miss' do
+    calls = 0
+    2.times { cache.fetch(:a) { calls += 1; Numo::SFloat.zeros(100) } }
+    expect(calls).to eq(1)
+    expect(cache.hits).to eq(1)
+    expect(cache.misses).to eq(1)
+    expect(cache.samples).to eq(100)
+  end
+
+  it 'evicts the least recently used buffers when full' do
+    cache.fetch(:a) { Numo::SFloat.zeros(400) }
+    cache.fetch(:b) { Numo::SFloat.zeros(400) }
+    cache.fetch(:a) { raise 'should be cached' }
+    cache.fetch(:c) { Numo::SFloat.zeros(400) }
+
+    expect(cache.include?(:a)).to eq(true)
+    expect(cache.include?(:b)).to eq(false)
+    expect(cache.include?(:c)).to eq(true)
+    expect(cache.samples).to eq(800)
+  end
+
+  it 'does not cache buffers larger than the limit' do
+    result = cache.fetch(:big) { Numo::SFloat.zeros(2000) }
+    expect(result.length).to eq(2000)
+    expect(cache.size).to eq(0)
+  end
+
+  it 'can be cleared' do
+    cache.fetch(:a) { Numo::SFloat.zeros(10) }
+    cache.clear
+    expect(cache.size).to eq(0)
+    expect(cache.samples).to eq(0)
+  end
+end
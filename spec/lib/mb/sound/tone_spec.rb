@@ -201,6 +201,86 @@ RSpec.describe MB::Sound::Tone do
     end
   end
 
+  context 'with a tone cache' do
+    let(:cache) { MB::Sound::ToneCache.new(max_samples: 480000) }
+
+    before(:each) do
+      @old_cache = MB::Sound::Tone.cache
+      MB::Sound::Tone.cache = cache
+    end
+
+    after(:each) do
+      MB::Sound::Tone.cache = @old_cache
+    end
+
+    # Generates samples without the cache, for comparison
+    def uncached(tone, *counts)
+      MB::Sound::Tone.cache = nil
+      counts.map { |c| tone.generate(c).dup }
+    ensure
+      MB::Sound::Tone.cache = cache
+    end
+
+    it 'reuses the rendering of a repeated tone' do
+      a = 100.hz.triangle.at(-20.db).for(0.25).generate.dup
+      b = 100.hz.triangle.at(-20.db).for(0.25).generate
+      expect(cache.misses).to eq(1)
+      expect(cache.hits).to eq(1)
+      expect(b).to eq(a)
+      expect(b).to eq(uncached(100.hz.triangle.at(-20.db).for(0.25), nil)[0])
+    end
+
+    it 'continues a finite tone across multiple calls' do
+      expected = uncached(123.hz.square.for(0.1), 4800)[0]
+      tone = 123.hz.square.for(0.1)
+      result = Numo::SFloat.zeros(4800)
+      [0...1000, 1000...3000, 3000...4800].each do |r|
+        result[r] = tone.generate(r.size)
+      end
+      expect((result - expected).abs.max).to be < 1e-5
+    end
+
+    it 'switches to the oscillator when reading past the duration' do
+      expected = Numo::SFloat.cast(uncached(123.hz.for(0.01), 480, 480).map(&:to_a).flatten)
+      tone = 123.hz.for(0.01)
+      result = Numo::SFloat.cast([tone.generate(480).to_a, tone.generate(480).to_a].flatten)
+      expect((result - expected).abs.max).to be < 1e-5
+    end
+
+    context 'with a small tone limit' do
+      let(:cache) { MB::Sound::ToneCache.new(max_samples: 480000, max_tone_samples: 4800) }
+
+      it 'streams longer tones without rendering them in full' do
+        expected = uncached(123.hz.for(0.2), 960)[0]
+        expect(123.hz.for(0.2).generate(960)).to eq(expected)
+        expect(cache.misses).to eq(0)
+        expect(cache.size).to eq(0)
+      end
+    end
+
+    it 'tiles a cached cycle for an infinite tone' do
+      expected = uncached(440.hz.forever, 10000)[0]
+      tone = 440.hz.forever
+      result = Numo::SFloat.cast([tone.generate(3000).to_a, tone.generate(7000).to_a].flatten)
+      expect((result - expected).abs.max).to be < 1e-4
+      expect(cache.samples).to eq(1200) # 11 cycles of 440Hz at 48kHz
+    end
+
+    it 'remembers the cycle length, even nil, until the frequency changes' do
+      tone = 440.1.hz.forever
+      expect(tone.send(:cycle_length)).to eq(nil)
+      expect(tone.instance_variable_get(:@cycle_length_key)).to eq([440.1, 48000])
+
+      tone.send(:set_frequency, 440)
+      expect(tone.send(:cycle_length)).to eq(1200)
+    end
+
+    it 'does not cache noise' do
+      1.hz.gauss.noise.generate(100)
+      expect(cache.size).to eq(0)
+    end
+  end
+
   describe '#oscillator' do
     it 'returns an Oscillator with the same frequency and range' do
       tone = 222.hz.at(-5.db)
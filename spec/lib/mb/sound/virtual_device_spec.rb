@@ -0,0 +1,72 @@
+RSpec.describe(MB::Sound::VirtualDevice) do
+  let(:data) { [Numo::SFloat.linspace(-1, 1, 16), Numo::SFloat.linspace(1, -1, 16)] }
+
+  context 'when not running in real time' do
+    let(:dev) { MB::Sound::VirtualDevice.new(channels: 2, period: 16, periods: 2, realtime: false) }
+
+    it 'passes audio from the output to the input' do
+      expect(Kernel).not_to receive(:sleep)
+      expect(dev.output.write(data)).to eq(16)
+      expect(dev.input.read(16)).to eq(data)
+      expect(dev.stats.values).to all(eq(0))
+    end
+
+    it 'has the stream attributes expected of inputs and outputs' do
+      expect(dev.input.channels).to eq(2)
+      expect(dev.output.rate).to eq(48000)
+      expect(dev.input.buffer_size).to eq(16)
+    end
+
+    it 'fills underruns with zeros' do
+      dev.output.write(data.map { |c| c[0...10] })
+      result = dev.input.read(16)
+      expect(result[0][0...10]).to eq(data[0][0...10])
+      expect(result[0][10..-1]).to eq(Numo::SFloat.zeros(6))
+      expect(dev.underruns).to eq(6)
+    end
+
+    it 'counts overruns when the input does not keep up' do
+      3.times do dev.output.write(data) end
+      expect(dev.overruns).to eq(16)
+    end
+
+    it 'drops every period when xrun_chance is 1' do
+      dev = MB::Sound::VirtualDevice.new(channels: 2, period: 16, realtime: false, xrun_chance: 1)
+      dev.output.write(data)
+      expect(dev.input.read(16)).to eq([Numo::SFloat.zeros(16)] * 2)
+      expect(dev.xruns).to eq(2)
+    end
+
+    it 'repeats short reads given the same seed' do
+      a = MB::Sound::VirtualDevice.new(channels: 1, realtime: false, short_read_chance: 0.5, seed: 5)
+      b = MB::Sound::VirtualDevice.new(channels: 1, realtime: false, short_read_chance: 0.5, seed: 5)
+
+      lengths_a = 20.times.map { a.input.read(256)[0].length }
+      lengths_b = 20.times.map { b.input.read(256)[0].length }
+
+      expect(lengths_a).to eq(lengths_b)
+      expect(lengths_a).to all(be_between(1, 256))
+      expect(a.short_reads).to be > 0
+      expect(a.short_reads).to eq(lengths_a.count { |l| l < 256 })
+    end
+  end
+
+  context 'when running in real time' do
+    it 'paces reads to the sample rate' do
+      dev = MB::Sound::VirtualDevice.new(channels: 1, rate: 1000, period: 50)
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      5.times do dev.input.read(50) end
+      elapsed = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+      expect(elapsed).to be_between(0.2, 0.4)
+    end
+  end
+
+  describe '#close' do
+    it 'closes both ends' do
+      dev = MB::Sound::VirtualDevice.new(realtime: false)
+      dev.close
+      expect { dev.input.read(1) }.to raise_error(/closed/)
+      expect { dev.output.write([Numo::SFloat[0]] * 2) }.to raise_error(/closed/)
+    end
+  end
+end
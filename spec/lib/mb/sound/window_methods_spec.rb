@@ -48,6 +48,148 @@ RSpec.describe(MB::Sound::WindowMethods) do
     end
   end
 
+  describe '#process_large' do
+    let(:input) { 'sounds/synth0.flac' }
+    let(:output) { 'tmp/process_large_test.flac' }
+    let(:reference) { 'tmp/process_large_reference.flac' }
+    let(:in_sound) { MB::Sound.read(input) }
+    let(:out_sound) { MB::Sound.read(output) }
+
+    before(:each) do
+      FileUtils.mkdir_p('tmp')
+      File.unlink(output) rescue nil
+      File.unlink(reference) rescue nil
+    end
+
+    it 'can amplify sound' do
+      MB::Sound.process_large(input, output, memory: 1 << 20) do |dfts, range|
+        dfts.map { |c| c * 0.5 }
+      end
+      expect(out_sound[0].length).to eq(in_sound[0].length)
+      expect(out_sound.map { |c| c.max.round(4) }).to eq(in_sound.map { |c| (c.max * 0.5).round(4) })
+    end
+
+    it 'matches #process' do
+      filter = ->(dfts) { dfts.map(&:conj) }
+      MB::Sound.process(input, reference, &filter)
+      MB::Sound.process_large(input, output, memory: 1 << 20, workers: 2) { |dfts, range| filter.call(dfts) }
+
+      expected = MB::Sound.read(reference)
+      expect(out_sound[0].length).to eq(expected[0].length)
+      expect((out_sound[0] - expected[0]).abs.max).to be < 1e-3
+    end
+
+    it 'yields every positive frequency bin once' do
+      ranges = []
+      MB::Sound.process_large(input, output, memory: 1 << 20) { |dfts, range| ranges << range; dfts }
+      expect(ranges.first.first).to eq(0)
+      expect(ranges.each_cons(2).all? { |a, b| a.end == b.first }).to eq(true)
+      expect(ranges.last.end).to be >= in_sound[0].length / 2 + 1
+    end
+  end
+
+  describe '#stream_process' do
+    let(:input) { 'sounds/synth0.flac' }
+    let(:output) { 'tmp/stream_process_test.flac' }
+    let(:reference) { 'tmp/stream_process_reference.flac' }
+    let(:in_sound) { MB::Sound.read(input) }
+    let(:out_sound) { MB::Sound.read(output) }
+
+    before(:each) do
+      FileUtils.mkdir_p('tmp')
+      File.unlink(output) rescue nil
+      File.unlink(reference) rescue nil
+    end
+
+    it 'can pass sound through unchanged' do
+      MB::Sound.stream_process(input, output) { |dfts| dfts }
+      expect(out_sound.length).to eq(in_sound.length)
+      expect(out_sound[0].length).to eq(in_sound[0].length)
+      expect((out_sound[0] - in_sound[0]).abs.max).to be < 1e-3
+    end
+
+    it 'matches #process' do
+      filter = ->(dfts) { dfts.map { |c| c * Numo::SFloat.linspace(1, 0, c.length) * 10 } }
+      MB::Sound.process(input, reference, &filter)
+      MB::Sound.stream_process(input, output, &filter)
+
+      expected = MB::Sound.read(reference)
+      expect(out_sound[0].length).to eq(expected[0].length)
+      expect((out_sound[0] - expected[0]).abs.max).to be < 1e-3
+    end
+  end
+
+  describe '#stream_process_split' do
+    let(:input) { 'sounds/synth0.flac' }
+    let(:output) { 'tmp/stream_process_split_test.flac' }
+    let(:in_sound) { MB::Sound.read(input) }
+    let(:out_sound) { MB::Sound.read(output) }
+
+    before(:each) do
+      FileUtils.mkdir_p('tmp')
+      File.unlink(output) rescue nil
+    end
+
+    it 'can pass sound through unchanged' do
+      MB::Sound.stream_process_split(input, output, 4000) { |dfts| dfts }
+      expect(out_sound.length).to eq(in_sound.length)
+      expect(out_sound[0].length).to eq(in_sound[0].length)
+      expect((out_sound[0] - in_sound[0]).abs.max).to be < 1e-3
+    end
+
+    it 'applies a fixed gain' do
+      MB::Sound.stream_process_split(input, output, 4000, gain: 0.25) { |dfts| dfts }
+      expect(out_sound[0].abs.max.round(3)).to eq((in_sound[0].abs.max * 0.25).round(3))
+    end
+
+    it 'normalizes loud output to a peak of 1' do
+      MB::Sound.stream_process_split(input, output, 4000) { |dfts| dfts.map { |c| c * 10 } }
+      expect(out_sound.map { |c| c.abs.max }.max.round(3)).to eq(1)
+    end
+
+    it 'yields chunks of the split size' do
+      sizes = []
+      MB::Sound.stream_process_split(input, output, 4000) { |dfts| sizes << dfts[0].length; dfts }
+      expect(sizes.uniq).to eq([2001])
+      expect(sizes.length).to eq((in_sound[0].length / 4000.0).ceil)
+    end
+  end
+
+  describe '#stream_process_overlap' do
+    let(:input) { 'sounds/synth0.flac' }
+    let(:output) { 'tmp/stream_process_overlap_test.flac' }
+    let(:reference) { 'tmp/stream_process_overlap_reference.flac' }
+    let(:in_sound) { MB::Sound.read(input) }
+    let(:out_sound) { MB::Sound.read(output) }
+
+    before(:each) do
+      FileUtils.mkdir_p('tmp')
+      File.unlink(output) rescue nil
+      File.unlink(reference) rescue nil
+    end
+
+    it 'can pass sound through unchanged' do
+      MB::Sound.stream_process_overlap(input, output, 4000, 1000) { |dfts| dfts }
+      expect(out_sound[0].length).to eq(in_sound[0].length)
+      expect((out_sound[0] - in_sound[0]).abs.max).to be < 1e-3
+    end
+
+    it 'matches #process_overlap' do
+      filter = ->(dfts) { dfts.map { |c| c * Numo::SFloat.linspace(1, 0, c.length) } }
+      MB::Sound.process_overlap(input, reference, 4000, 1000, &filter)
+      MB::Sound.stream_process_overlap(input, output, 4000, 1000, &filter)
+
+      expected = MB::Sound.read(reference)
+      expect(out_sound[0].length).to eq(expected[0].length)
+      expect((out_sound[0] - expected[0]).abs.max).to be < 1e-3
+    end
+
+    it 'normalizes loud output to a peak of 1' do
+      MB::Sound.stream_process_overlap(input, output, 4000, 1000) { |dfts| dfts.map { |c| c * 10 } }
+      expect(out_sound.map { |c| c.abs.max }.max.round(3)).to eq(1)
+    end
+  end
+
   pending '#process_split'
   pending '#process_overlap'
   pending '#process_time_stream'
@@ -1,4 +1,12 @@
 RSpec.describe MB::Sound::WindowReader do
+  describe '#latency' do
+    it 'is the overlap between windows' do
+      w = MB::Sound::Window::Hann.new(1024)
+      reader = MB::Sound::WindowReader.new(MB::Sound::NullInput.new(channels: 1), w)
+      expect(reader.latency).to eq(1024 - w.hop)
+    end
+  end
+
   describe '#read' do
     def read_everything(frames:, window_size:, hop:, fill_value:)
       w = MB::Sound::Window::DoubleHann.new(1024)
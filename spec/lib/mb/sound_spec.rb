@@ -13,5 +13,61 @@ RSpec.describe MB::Sound do
       expect(low_gain).to be > -1.db
       expect(high_gain).to be < -30.db
     end
+
+    context 'with an output' do
+      let(:input) { 'sounds/synth0.flac' }
+      let(:output) { 'tmp/filter_stream_test.flac' }
+
+      before(:each) do
+        FileUtils.mkdir_p('tmp')
+        File.unlink(output) rescue nil
+      end
+
+      it 'streams a file through the filter to the output' do
+        frames = MB::Sound.filter(input, output: output, frequency: 1000, quality: 0.7, buffer_size: 1000)
+        expected = MB::Sound.filter(MB::Sound.read(input), frequency: 1000, quality: 0.7)
+        result = MB::Sound.read(output)
+
+        expect(frames).to eq(expected[0].length)
+        expect(result.length).to eq(expected.length)
+        expect((result[0] - expected[0]).abs.max).to be < 1e-3
+        expect((result[1] - expected[1]).abs.max).to be < 1e-3
+      end
+
+      it 'can write to an output stream' do
+        data = 2.times.map { Numo::SFloat.new(5000).rand(-1, 1) }
+        out = MB::Sound::NullOutput.new(channels: 2, sleep: false)
+        frames = MB::Sound.filter(MB::Sound::ArrayInput.new(data), output: out, frequency: 100, quality: 0.7)
+        expect(frames).to eq(5000)
+        expect(out.frames_written).to eq(5000)
+      end
+    end
+  end
+
+  describe '.filter_stream' do
+    it 'carries filter state across blocks' do
+      data = [Numo::SFloat.new(5000).rand(-1, 1)]
+      expected = MB::Sound::Filter::Cookbook.new(:lowpass, 48000, 500, quality: 0.7).tap { |f| f.reset(data[0][0]) }.process(data[0])
+
+      collected = []
+      out = MB::Sound::NullOutput.new(channels: 1, sleep: false)
+      allow(out).to receive(:write) { |d| collected << d[0] }
+
+      filters = [MB::Sound::Filter::Cookbook.new(:lowpass, 48000, 500, quality: 0.7)]
+      MB::Sound.filter_stream(MB::Sound::ArrayInput.new(data), out, filters, buffer_size: 333)
+
+      result = Numo::SFloat.cast(collected.map(&:to_a).flatten)
+      expect((result - expected).abs.max).to be < 1e-5
+    end
+
+    it 'accepts a multichannel processor' do
+      data = [Numo::SFloat[1, 2, 3], Numo::SFloat[4, 5, 6]]
+      out = MB::Sound::NullOutput.new(channels: 1, sleep: false)
+      collected = []
+      allow(out).to receive(:write) { |d| collected << d }
+
+      MB::Sound.filter_stream(MB::Sound::ArrayInput.new(data), out, MB::Sound::ProcessingMatrix.new(Matrix[[1, 1]]))
+      expect(collected[0][0].to_a).to eq([5, 7, 9])
+    end
   end
 end
@@ -11,6 +11,8 @@ ENV['RUBYOPT'] = "-r#{File.join(__dir__, 'simplecov_helper.rb')} #{ENV['RUBYOPT'
 
 require 'mb/sound'
 
+Dir[File.join(__dir__, 'support', '**', '*.rb')].sort.each { |f| require f }
+
 # This file was generated by the `rspec --init` command. Conventionally, all
 # specs live under a `spec` directory, which RSpec adds to the `$LOAD_PATH`.
 # The generated `.rspec` file contains `--require spec_helper` which will cause
@@ -0,0 +1,39 @@
+module MB
+  module Sound
+    # Helpers shared by specs.  Loaded by spec_helper.rb.
+    module SpecSupport
+      # An output stream for specs that keeps all audio written to it, one
+      # Numo::NArray per channel in #data, optionally sleeping for +:delay+
+      # seconds in each write to simulate a slow output.
+      class CollectingOutput
+        attr_reader :channels, :rate, :buffer_size, :filename, :data, :closed
+
+        def initialize(channels: 1, rate: 48000, buffer_size: 800, filename: nil, delay: 0)
+          @channels = channels
+          @rate = rate
+          @buffer_size = buffer_size
+          @filename = filename
+          @delay = delay
+          @data = channels.times.map { Numo::SFloat[] }
+          @closed = false
+        end
+
+        def write(data)
+          raise "Expected #{@channels} channels, got #{data.length}" unless data.length == @channels
+          sleep @delay if @delay > 0
+          @data = @data.map.with_index { |c, idx| c.concatenate(data[idx]) }
+          data[0].length
+        end
+
+        # Returns everything written to the first channel.
+        def audio
+          @data[0]
+        end
+
+        def close
+          @closed = true
+        end
+      end
+    end
+  end
+end